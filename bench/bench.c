@@ -0,0 +1,795 @@
+// bench.c — throughput and ratio benchmark for the LZSS library, with
+// Okumura's 1989 LZSS.C as the baseline and a regression gate.
+//
+// The corpus is generated in memory from fixed seeds, so every run and every
+// machine sees the same bytes: English-like text, game-style bitmaps in the
+// spirit of sample.ppm, random bytes and highly repetitive records, at 1 KB,
+// 64 KB, 1 MB, 16 MB, 256 MB and 1 GB up to the -s limit. Every file is
+// round-tripped by every codec it is run through. Results go out as JSON;
+// given a baseline written by an earlier run, bench exits with 3 when a
+// level's ratio or its median speedup over 1989 has regressed past the
+// tolerance. Neither depends on how fast the machine is, so a baseline
+// recorded on one host gates any other.
+
+#define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "../lzss.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// bench_1989.c
+size_t lzss1989_encode(FILE *in, FILE *out);
+void lzss1989_decode(FILE *in, FILE *out);
+
+static FILE *xfopen(const char *path, const char *mode)
+{
+    FILE *f = fopen(path, mode);
+    if (!f)
+    {
+        fprintf(stderr, "open %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    return f;
+}
+
+static void *xmalloc(size_t n)
+{
+    void *p = malloc(n ? n : 1);
+    if (!p)
+    {
+        fprintf(stderr, "oom\n");
+        exit(1);
+    }
+    return p;
+}
+
+enum
+{
+    MAX_REPS = 101,
+    MAX_RESULTS = 256,
+    BASELINE_1989_MAX = 1 << 24, // the 1989 code is too slow to wait for past 16 MB
+    EXIT_ROUNDTRIP = 2,
+    EXIT_REGRESSION = 3
+};
+
+static const double MIN_REP_SECONDS = 0.05; // small files repeat inside one rep up to this
+static const double SPEED_TOL_DEFAULT = 40.0; // -t: same-host reruns move a median speedup by up to ~38%
+static const uint64_t SPEED_GATE_MIN = (uint64_t)1 << 16; // smaller cases time stdio setup, not the codec
+
+static double now_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+// Peak resident memory of one case. Linux resets the high-water mark on a
+// write of "5" to clear_refs, so each case reads back only its own peak as
+// VmHWM. Elsewhere there is no such reset and no measurement: -1.
+static bool peak_rss_reset(void)
+{
+#ifdef __linux__
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if (!f)
+        return false;
+    bool ok = fputs("5", f) >= 0;
+    return fclose(f) == 0 && ok;
+#else
+    return false;
+#endif
+}
+
+static long peak_rss_kb(bool reset)
+{
+    long kb = -1;
+#ifdef __linux__
+    FILE *f = reset ? fopen("/proc/self/status", "r") : NULL;
+    if (!f)
+        return -1;
+    char line[256];
+    while (fgets(line, sizeof line, f))
+        if (strncmp(line, "VmHWM:", 6) == 0)
+            kb = strtol(line + 6, NULL, 10);
+    fclose(f);
+#else
+    (void)reset;
+#endif
+    return kb;
+}
+
+// ----------------------------------------------------------------------------
+// Corpus
+// ----------------------------------------------------------------------------
+
+typedef struct
+{
+    uint64_t s;
+} Rng;
+
+static uint64_t rng_next(Rng *r)
+{
+    r->s ^= r->s >> 12;
+    r->s ^= r->s << 25;
+    r->s ^= r->s >> 27;
+    return r->s * 0x2545F4914F6CDD1Dull;
+}
+
+// Uniform in [0, n).
+static uint32_t rng_below(Rng *r, uint32_t n)
+{
+    return (uint32_t)(((rng_next(r) >> 32) * n) >> 32);
+}
+
+static const char *const WORDS[] = {
+    "the", "of", "and", "to", "a", "in", "is", "it", "you", "that", "he", "was", "for", "on", "are", "with",
+    "as", "his", "they", "be", "at", "one", "have", "this", "from", "or", "had", "by", "word", "but", "what",
+    "some", "we", "can", "out", "other", "were", "all", "there", "when", "up", "use", "your", "how", "said",
+    "an", "each", "she", "which", "do", "their", "time", "if", "will", "way", "about", "many", "then", "them",
+    "would", "write", "like", "so", "these", "her", "long", "make", "thing", "see", "him", "two", "has",
+    "look", "more", "day", "could", "go", "come", "did", "number", "sound", "no", "most", "people", "my",
+    "over", "know", "water", "than", "call", "first", "who", "may", "down", "side", "been", "now", "find",
+    "house", "puzzle", "stauf", "mansion", "guest", "doll", "portrait", "staircase", "laboratory", "attic",
+    "chapel", "library", "kitchen", "dining", "hallway", "telescope", "microscope", "coffin", "cake"};
+enum
+{
+    WORD_COUNT = sizeof WORDS / sizeof WORDS[0]
+};
+
+// Sentences of Zipf-ish word frequencies, wrapped at 72 columns, with
+// paragraph breaks.
+static size_t gen_text(uint8_t *buf, size_t cap, Rng *r)
+{
+    size_t n = 0, col = 0;
+    while (n < cap)
+    {
+        int words = 4 + (int)rng_below(r, 14);
+        for (int i = 0; i < words && n < cap; ++i)
+        {
+            uint32_t a = rng_below(r, WORD_COUNT), b = rng_below(r, WORD_COUNT);
+            const char *w = WORDS[a * b / WORD_COUNT];
+            size_t len = strlen(w);
+            bool last = i == words - 1;
+            bool comma = !last && rng_below(r, 10) == 0;
+            if (col + len + 2 > 72)
+            {
+                buf[n++] = '\n';
+                col = 0;
+            }
+            else if (col > 0)
+            {
+                buf[n++] = ' ';
+                ++col;
+            }
+            for (size_t j = 0; j < len && n < cap; ++j)
+                buf[n++] = (uint8_t)(i == 0 && j == 0 ? w[j] - 'a' + 'A' : w[j]);
+            if (n < cap && (comma || last))
+                buf[n++] = (uint8_t)(last ? (rng_below(r, 8) ? '.' : '?') : ',');
+            col += len + 1;
+        }
+        if (n + 2 <= cap && rng_below(r, 7) == 0)
+        {
+            buf[n++] = '\n';
+            buf[n++] = '\n';
+            col = 0;
+        }
+    }
+    return cap;
+}
+
+// A P6 image in the style of an early CD-ROM game frame: a 16-colour palette,
+// sky bands with ordered dithering, a floor of 16x16 tiles and sprites stamped
+// over both. The image is as large as fits, so the file can end up to one row
+// short of cap.
+static size_t gen_bitmap(uint8_t *buf, size_t cap, Rng *r)
+{
+    static const uint8_t BAYER[4][4] = {{0, 8, 2, 10}, {12, 4, 14, 6}, {3, 11, 1, 9}, {15, 7, 13, 5}};
+    size_t w = 8;
+    while ((w * 2) * (w * 2) * 3 <= cap)
+        w *= 2;
+    size_t h = (cap - 32) / (3 * w);
+    size_t hdr = (size_t)snprintf((char *)buf, cap, "P6\n%zu %zu\n255\n", w, h);
+    uint8_t *px = buf + hdr;
+
+    uint8_t pal[16][3];
+    for (int i = 0; i < 16; ++i)
+        for (int c = 0; c < 3; ++c)
+            pal[i][c] = (uint8_t)(i < 8 ? (uint32_t)(40 + i * 24 + c * 8) : rng_below(r, 256));
+    uint8_t tiles[4][16][16];
+    for (int t = 0; t < 4; ++t)
+        for (int y = 0; y < 16; ++y)
+            for (int x = 0; x < 16; ++x)
+                tiles[t][y][x] = (uint8_t)(8 + t + (rng_below(r, 12) == 0 ? 4 : 0)); // speckled
+
+    size_t horizon = h / 2 ? h / 2 : 1;
+    for (size_t y = 0; y < h; ++y)
+        for (size_t x = 0; x < w; ++x)
+        {
+            unsigned idx;
+            if (y < horizon)
+            {
+                size_t pos = y * 7 * 16 / horizon; // 7 bands, 16 dither steps each
+                idx = (unsigned)(pos / 16) + (BAYER[y & 3][x & 3] < pos % 16);
+            }
+            else
+            {
+                uint64_t cell = ((uint64_t)(y / 16) << 32 | (x / 16)) * 0x9E3779B97F4A7C15ull;
+                idx = tiles[cell >> 62][y % 16][x % 16];
+            }
+            memcpy(px + (y * w + x) * 3, pal[idx], 3);
+        }
+
+    size_t sprites = w * h / 4096;
+    for (size_t s = 0; s < sprites && w > 16 && h > 16; ++s)
+    {
+        size_t sx = rng_below(r, (uint32_t)(w - 16)), sy = rng_below(r, (uint32_t)(h - 16));
+        unsigned ink = 8 + rng_below(r, 8);
+        for (int y = 0; y < 16; ++y)
+            for (int x = 0; x < 16; ++x)
+                if ((x - 8) * (x - 8) + (y - 8) * (y - 8) < 49)
+                    memcpy(px + ((sy + (size_t)y) * w + sx + (size_t)x) * 3, pal[(x + y) % 5 ? ink : 7], 3);
+    }
+    return hdr + w * h * 3;
+}
+
+static size_t gen_random(uint8_t *buf, size_t cap, Rng *r)
+{
+    for (size_t i = 0; i < cap; i += 8)
+    {
+        uint64_t v = rng_next(r);
+        memcpy(buf + i, &v, cap - i < 8 ? cap - i : 8);
+    }
+    return cap;
+}
+
+// Fixed-layout records with a counter and rare variations, broken up by long
+// runs of zeros.
+static size_t gen_repeat(uint8_t *buf, size_t cap, Rng *r)
+{
+    static const char *const STATES[] = {"idle", "playing", "loading", "paused"};
+    size_t n = 0;
+    for (uint32_t id = 0; n < cap; ++id)
+    {
+        char rec[64];
+        size_t len;
+        if (rng_below(r, 128) == 0)
+        {
+            len = 256 + rng_below(r, 4096);
+            len = len < cap - n ? len : cap - n;
+            memset(buf + n, 0, len);
+        }
+        else
+        {
+            len = (size_t)snprintf(rec, sizeof rec, "%08u;%s;frame=%06u;ok\n", id,
+                                   STATES[rng_below(r, 16) == 0 ? rng_below(r, 4) : 0], id / 30);
+            len = len < cap - n ? len : cap - n;
+            memcpy(buf + n, rec, len);
+        }
+        n += len;
+    }
+    return cap;
+}
+
+typedef struct
+{
+    const char *name;
+    const char *ext;
+    size_t (*gen)(uint8_t *buf, size_t cap, Rng *r);
+} Kind;
+
+static const Kind KINDS[] = {
+    {"text", "txt", gen_text},
+    {"bitmap", "ppm", gen_bitmap},
+    {"random", "bin", gen_random},
+    {"repeat", "bin", gen_repeat},
+};
+
+static const struct
+{
+    const char *name;
+    size_t size;
+} SIZES[] = {
+    {"1K", (size_t)1 << 10},   {"64K", (size_t)1 << 16},   {"1M", (size_t)1 << 20},
+    {"16M", (size_t)1 << 24}, {"256M", (size_t)1 << 28}, {"1G", (size_t)1 << 30},
+};
+
+// ----------------------------------------------------------------------------
+// Measurement
+// ----------------------------------------------------------------------------
+
+typedef struct
+{
+    double p10, p50, p90; // MB/s of the input size
+} Rate;
+
+typedef struct
+{
+    char file[16]; // "<kind>-<size>"
+    char codec[8]; // "lzss" or "1989"
+    int level;     // library level; 0 for 1989
+    uint64_t size, packed;
+    double ratio; // packed / size
+    Rate enc, dec;
+    double vs_enc, vs_dec; // median speedup over 1989 on the same file, 0 if not run
+    bool roundtrip;
+    long peak_rss_kb; // -1 if not measured
+} Result;
+
+// One benchmark subject: a corpus file and the buffers or streams it runs
+// through.
+typedef struct
+{
+    const uint8_t *raw;
+    size_t raw_len;
+    uint8_t *packed;
+    size_t packed_cap, packed_len;
+    uint8_t *back;
+    lzss_encoder *enc; // reused, so allocation stays out of the timings
+    FILE *f_raw, *f_packed, *f_back;
+} Case;
+
+static bool run_lzss_encode(Case *c)
+{
+    int64_t n = lzss_compress_ctx(c->enc, c->raw, c->raw_len, 0, c->packed, c->packed_cap);
+    c->packed_len = n > 0 ? (size_t)n : 0;
+    return n >= 0;
+}
+
+static bool run_lzss_decode(Case *c)
+{
+    return lzss_decompress(c->packed, c->packed_len, c->back, c->raw_len) == (int64_t)c->raw_len;
+}
+
+// The 1989 code works on stdio streams, so it is timed as it runs: from one
+// tmpfile() to another, flushed.
+static bool run_1989_encode(Case *c)
+{
+    rewind(c->f_raw);
+    rewind(c->f_packed);
+    c->packed_len = lzss1989_encode(c->f_raw, c->f_packed);
+    return fflush(c->f_packed) == 0;
+}
+
+static bool run_1989_decode(Case *c)
+{
+    rewind(c->f_packed);
+    rewind(c->f_back);
+    lzss1989_decode(c->f_packed, c->f_back);
+    return fflush(c->f_back) == 0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Runs warmup untimed passes, then reps timed ones. A rep that would be
+// shorter than MIN_REP_SECONDS repeats the run and takes the mean, so small
+// files are not timed at clock resolution.
+static Rate measure(bool (*run)(Case *), Case *c, int warmup, int reps, bool *ok)
+{
+    double once = 0;
+    for (int i = 0; i < (warmup > 0 ? warmup : 1); ++i)
+    {
+        double t0 = now_seconds();
+        *ok &= run(c);
+        once = now_seconds() - t0;
+    }
+    long iters = once >= MIN_REP_SECONDS ? 1 : (long)(MIN_REP_SECONDS / (once > 1e-7 ? once : 1e-7)) + 1;
+
+    double rate[MAX_REPS];
+    for (int r = 0; r < reps; ++r)
+    {
+        double t0 = now_seconds();
+        for (long i = 0; i < iters; ++i)
+            *ok &= run(c);
+        double secs = (now_seconds() - t0) / (double)iters;
+        rate[r] = secs > 0 ? (double)c->raw_len / secs / 1e6 : 0.0;
+    }
+    qsort(rate, (size_t)reps, sizeof rate[0], cmp_double);
+    return (Rate){rate[(reps - 1) / 10], rate[(reps - 1) / 2], rate[(reps - 1) * 9 / 10]};
+}
+
+// Reads f back and compares it with want.
+static bool file_equals(FILE *f, const uint8_t *want, size_t len, uint8_t *scratch)
+{
+    rewind(f);
+    size_t got = fread(scratch, 1, len, f);
+    return got == len && getc(f) == EOF && memcmp(scratch, want, len) == 0;
+}
+
+static Result bench_1989(Case *c, const char *file, int warmup, int reps)
+{
+    Result res = {.codec = "1989", .size = c->raw_len};
+    snprintf(res.file, sizeof res.file, "%s", file);
+    c->f_raw = tmpfile();
+    c->f_packed = tmpfile();
+    c->f_back = tmpfile();
+    if (!c->f_raw || !c->f_packed || !c->f_back)
+    {
+        fprintf(stderr, "tmpfile: %s\n", strerror(errno));
+        exit(1);
+    }
+    fwrite(c->raw, 1, c->raw_len, c->f_raw);
+    fflush(c->f_raw);
+
+    bool ok = true;
+    res.enc = measure(run_1989_encode, c, warmup, reps, &ok);
+    res.dec = measure(run_1989_decode, c, warmup, reps, &ok);
+    res.packed = c->packed_len;
+    res.roundtrip = ok && file_equals(c->f_back, c->raw, c->raw_len, c->back);
+    fclose(c->f_raw);
+    fclose(c->f_packed);
+    fclose(c->f_back);
+    return res;
+}
+
+static Result bench_lzss(Case *c, const char *file, int level, int warmup, int reps)
+{
+    Result res = {.codec = "lzss", .level = level, .size = c->raw_len};
+    snprintf(res.file, sizeof res.file, "%s", file);
+    c->enc = lzss_encoder_create(level);
+    if (!c->enc)
+    {
+        fprintf(stderr, "oom\n");
+        exit(1);
+    }
+    bool ok = true;
+    res.enc = measure(run_lzss_encode, c, warmup, reps, &ok);
+    memset(c->back, 0, c->raw_len);
+    res.dec = measure(run_lzss_decode, c, warmup, reps, &ok);
+    res.packed = c->packed_len;
+    res.roundtrip = ok && memcmp(c->back, c->raw, c->raw_len) == 0;
+    lzss_encoder_destroy(c->enc);
+    return res;
+}
+
+// ----------------------------------------------------------------------------
+// Reports
+// ----------------------------------------------------------------------------
+
+static void print_row(const Result *r)
+{
+    char codec[24];
+    if (strcmp(r->codec, "lzss") == 0)
+        snprintf(codec, sizeof codec, "-l %d %s", r->level, lzss_level_name(r->level));
+    else
+        snprintf(codec, sizeof codec, "1989 LZSS.C");
+    fprintf(stderr, "%-12s %-14s %7.4f %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f", r->file, codec, r->ratio, r->enc.p10,
+            r->enc.p50, r->enc.p90, r->dec.p10, r->dec.p50, r->dec.p90);
+    if (r->vs_enc > 0)
+        fprintf(stderr, " %6.1fx %6.1fx", r->vs_enc, r->vs_dec);
+    else
+        fprintf(stderr, " %7s %7s", "", "");
+    if (r->peak_rss_kb >= 0)
+        fprintf(stderr, " %7.1f", (double)r->peak_rss_kb / 1024.0);
+    else
+        fprintf(stderr, " %7s", "-");
+    fprintf(stderr, "%s\n", r->roundtrip ? "" : "  ROUND-TRIP FAILED");
+}
+
+// One result per line, so baselines diff cleanly and read back without a
+// JSON parser.
+static void write_json(FILE *out, const Result *res, int count, size_t max_size, int warmup, int reps)
+{
+    fprintf(out, "{\n  \"tool\": \"lzss-bench\",\n  \"version\": 2,\n  \"simd\": \"%s\",\n", lzss_simd_name(lzss_simd()));
+    fprintf(out, "  \"max_size\": %zu,\n  \"warmup\": %d,\n  \"reps\": %d,\n  \"results\": [\n", max_size, warmup,
+            reps);
+    for (int i = 0; i < count; ++i)
+    {
+        const Result *r = &res[i];
+        char rss[24] = "null";
+        if (r->peak_rss_kb >= 0)
+            snprintf(rss, sizeof rss, "%ld", r->peak_rss_kb);
+        fprintf(out,
+                "    {\"file\": \"%s\", \"codec\": \"%s\", \"level\": %d, \"size\": %llu, \"packed\": %llu, "
+                "\"ratio\": %.6f, \"enc_mbps\": {\"p10\": %.2f, \"p50\": %.2f, \"p90\": %.2f}, "
+                "\"dec_mbps\": {\"p10\": %.2f, \"p50\": %.2f, \"p90\": %.2f}, "
+                "\"vs_1989\": {\"enc\": %.2f, \"dec\": %.2f}, \"roundtrip\": %s, \"peak_rss_kb\": %s}%s\n",
+                r->file, r->codec, r->level, (unsigned long long)r->size, (unsigned long long)r->packed, r->ratio,
+                r->enc.p10, r->enc.p50, r->enc.p90, r->dec.p10, r->dec.p50, r->dec.p90, r->vs_enc, r->vs_dec,
+                r->roundtrip ? "true" : "false", rss, i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+// Number after "key": in s, searching from the first occurrence of within
+// (or from s if within is NULL).
+static bool json_num(const char *s, const char *within, const char *key, double *v)
+{
+    char pat[32];
+    if (within && !(s = strstr(s, within)))
+        return false;
+    snprintf(pat, sizeof pat, "\"%s\":", key);
+    const char *p = strstr(s, pat);
+    if (!p)
+        return false;
+    *v = strtod(p + strlen(pat), NULL);
+    return true;
+}
+
+static bool json_str(const char *s, const char *key, char *out, size_t cap)
+{
+    char pat[32];
+    snprintf(pat, sizeof pat, "\"%s\": \"", key);
+    const char *p = strstr(s, pat);
+    if (!p)
+        return false;
+    p += strlen(pat);
+    size_t n = strcspn(p, "\"");
+    if (n >= cap)
+        return false;
+    memcpy(out, p, n);
+    out[n] = '\0';
+    return true;
+}
+
+// Loads the results of a JSON file written by bench -o.
+static int load_baseline(const char *path, Result *res, int cap)
+{
+    FILE *f = xfopen(path, "r");
+    char line[1024];
+    int count = 0;
+    while (count < cap && fgets(line, sizeof line, f))
+    {
+        Result r = {0};
+        double level;
+        if (!json_str(line, "file", r.file, sizeof r.file) || !json_str(line, "codec", r.codec, sizeof r.codec) ||
+            !json_num(line, NULL, "level", &level) || !json_num(line, NULL, "ratio", &r.ratio) ||
+            !json_num(line, "\"vs_1989\"", "enc", &r.vs_enc) || !json_num(line, "\"vs_1989\"", "dec", &r.vs_dec))
+            continue;
+        r.level = (int)level;
+        res[count++] = r;
+    }
+    fclose(f);
+    return count;
+}
+
+// Compares the library's results with the baseline's. Throughput is compared
+// as the speedup over 1989 on the same file, which carries across machines
+// where MB/s does not; rows without a 1989 run (-n, or files above
+// BASELINE_1989_MAX) are gated on ratio only, as are files below
+// SPEED_GATE_MIN. The 1989 rows never fail.
+static int check_regressions(const Result *cur, int count, const Result *base, int base_count, double speed_tol,
+                             double ratio_tol)
+{
+    int regressions = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const Result *c = &cur[i];
+        if (strcmp(c->codec, "lzss") != 0)
+            continue;
+        const Result *b = NULL;
+        for (int j = 0; j < base_count && !b; ++j)
+            if (strcmp(base[j].file, c->file) == 0 && strcmp(base[j].codec, c->codec) == 0 &&
+                base[j].level == c->level)
+                b = &base[j];
+        if (!b)
+            continue;
+        bool timed = c->size >= SPEED_GATE_MIN;
+        const struct
+        {
+            const char *what;
+            double now, was;
+            bool worse;
+        } checks[] = {
+            {"enc x 1989", c->vs_enc, b->vs_enc,
+             timed && c->vs_enc > 0 && b->vs_enc > 0 && c->vs_enc < b->vs_enc * (1.0 - speed_tol / 100.0)},
+            {"dec x 1989", c->vs_dec, b->vs_dec,
+             timed && c->vs_dec > 0 && b->vs_dec > 0 && c->vs_dec < b->vs_dec * (1.0 - speed_tol / 100.0)},
+            {"ratio", c->ratio, b->ratio, c->ratio > b->ratio * (1.0 + ratio_tol / 100.0) + 1e-6},
+        };
+        for (size_t k = 0; k < sizeof checks / sizeof checks[0]; ++k)
+            if (checks[k].worse)
+            {
+                fprintf(stderr, "REGRESSION %s -l %d: %s %.4g, baseline %.4g (%+.1f%%)\n", c->file, c->level,
+                        checks[k].what, checks[k].now, checks[k].was,
+                        checks[k].was > 0 ? (checks[k].now / checks[k].was - 1.0) * 100.0 : 0.0);
+                ++regressions;
+            }
+    }
+    return regressions;
+}
+
+// ----------------------------------------------------------------------------
+// Command line
+// ----------------------------------------------------------------------------
+
+static int simd_by_name(const char *name)
+{
+    for (int i = LZSS_SIMD_SCALAR; i <= LZSS_SIMD_AVX2; ++i)
+        if (strcmp(name, lzss_simd_name(i)) == 0)
+            return i;
+    return -1;
+}
+
+// "64K", "16M", "1G" or plain bytes; 0 if malformed.
+static size_t parse_size(const char *s)
+{
+    char *end;
+    unsigned long long v = strtoull(s, &end, 10);
+    int shift = *end == 'K' ? 10 : *end == 'M' ? 20 : *end == 'G' ? 30 : 0;
+    if (end == s || (shift && end[1] != '\0') || (!shift && *end != '\0'))
+        return 0;
+    return (size_t)(v << shift);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "  %s [-s max_size] [-l levels] [-r reps] [-w warmup] [-k simd] [-n] [-c corpus_dir]\n"
+            "     [-o out.json] [-b baseline.json [-t pct] [-R pct]]\n"
+            "Options:\n"
+            "  -s  largest corpus file: 1K, 64K, 1M (default), 16M, 256M or 1G\n"
+            "  -l  library levels to run, as digits (default 1234; 0 is the brute-force scan)\n"
+            "  -r  timed repetitions per measurement (default 7)\n"
+            "  -w  untimed warmup runs per measurement (default 1)\n"
+            "  -k  cap the SIMD kernels: scalar, sse2, ssse3 or avx2 (default: best the CPU has)\n"
+            "  -n  skip the 1989 LZSS.C baseline\n"
+            "  -c  also write the corpus files into this directory\n"
+            "  -o  write the JSON report here (default: stdout)\n"
+            "  -b  compare with this earlier report; exit 3 on a regression\n"
+            "  -t  allowed drop of the median speedup over 1989, in percent (default 40)\n"
+            "  -R  allowed ratio increase in percent (default 0.5)\n",
+            prog);
+}
+
+int main(int argc, char **argv)
+{
+    size_t max_size = (size_t)1 << 20;
+    char levels[LZSS_LEVEL_OPTIMAL + 2] = "1234";
+    int reps = 7, warmup = 1;
+    bool baseline_1989 = true;
+    const char *corpus_dir = NULL, *out_path = NULL, *baseline_path = NULL;
+    double speed_tol = SPEED_TOL_DEFAULT, ratio_tol = 0.5;
+
+    for (int arg = 1; arg < argc; arg += 2)
+    {
+        const char *opt = argv[arg];
+        if (strcmp(opt, "-n") == 0)
+        {
+            baseline_1989 = false;
+            arg -= 1;
+            continue;
+        }
+        if (arg + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        const char *val = argv[arg + 1];
+        long num = strtol(val, NULL, 10);
+        bool good = true;
+        if (strcmp(opt, "-s") == 0)
+            good = (max_size = parse_size(val)) >= SIZES[0].size && max_size <= SIZES[5].size;
+        else if (strcmp(opt, "-l") == 0)
+        {
+            good = strlen(val) < sizeof levels && strspn(val, "01234") == strlen(val) && val[0] != '\0';
+            if (good)
+                strcpy(levels, val);
+        }
+        else if (strcmp(opt, "-r") == 0)
+            good = (reps = (int)num) >= 1 && reps <= MAX_REPS;
+        else if (strcmp(opt, "-w") == 0)
+            good = (warmup = (int)num) >= 0 && warmup <= 100;
+        else if (strcmp(opt, "-k") == 0 && simd_by_name(val) >= 0)
+            lzss_simd_limit(simd_by_name(val));
+        else if (strcmp(opt, "-c") == 0)
+            corpus_dir = val;
+        else if (strcmp(opt, "-o") == 0)
+            out_path = val;
+        else if (strcmp(opt, "-b") == 0)
+            baseline_path = val;
+        else if (strcmp(opt, "-t") == 0)
+            good = (speed_tol = strtod(val, NULL)) >= 0;
+        else if (strcmp(opt, "-R") == 0)
+            good = (ratio_tol = strtod(val, NULL)) >= 0;
+        else
+            good = false;
+        if (!good)
+        {
+            fprintf(stderr, "bad option: %s %s\n", opt, val);
+            return 1;
+        }
+    }
+
+    static Result results[MAX_RESULTS];
+    int count = 0;
+    bool roundtrip = true;
+    fprintf(stderr, "kernels: %s, warmup %d, reps %d; MB/s as p10 / p50 / p90 of the input size\n",
+            lzss_simd_name(lzss_simd()), warmup, reps);
+    fprintf(stderr, "%-12s %-14s %7s %8s %8s %8s %8s %8s %8s %7s %7s %7s\n", "file", "codec", "ratio", "enc p10",
+            "p50", "p90", "dec p10", "p50", "p90", "enc x", "dec x", "rss MB");
+
+    for (size_t s = 0; s < sizeof SIZES / sizeof SIZES[0] && SIZES[s].size <= max_size; ++s)
+    {
+        size_t cap = SIZES[s].size;
+        uint8_t *raw = (uint8_t *)xmalloc(cap);
+        Case c = {.raw = raw, .packed_cap = lzss_bound(cap)};
+        c.packed = (uint8_t *)xmalloc(c.packed_cap);
+        c.back = (uint8_t *)xmalloc(cap);
+        for (size_t k = 0; k < sizeof KINDS / sizeof KINDS[0]; ++k)
+        {
+            Rng rng = {0x9E3779B97F4A7C15ull ^ (uint64_t)(k << 8 | s)};
+            c.raw_len = KINDS[k].gen(raw, cap, &rng);
+            char file[16];
+            snprintf(file, sizeof file, "%s-%s", KINDS[k].name, SIZES[s].name);
+            if (corpus_dir)
+            {
+                char path[1024];
+                snprintf(path, sizeof path, "%s/%s.%s", corpus_dir, file, KINDS[k].ext);
+                FILE *f = xfopen(path, "wb");
+                fwrite(raw, 1, c.raw_len, f);
+                fclose(f);
+            }
+
+            const Result *ref = NULL;
+            if (baseline_1989 && c.raw_len <= BASELINE_1989_MAX && count < MAX_RESULTS)
+            {
+                Result *r = &results[count++];
+                bool reset = peak_rss_reset();
+                *r = bench_1989(&c, file, warmup, reps);
+                r->ratio = (double)r->packed / (double)r->size;
+                r->peak_rss_kb = peak_rss_kb(reset);
+                roundtrip &= r->roundtrip;
+                print_row(r);
+                ref = r;
+            }
+            for (const char *l = levels; *l && count < MAX_RESULTS; ++l)
+            {
+                Result *r = &results[count++];
+                bool reset = peak_rss_reset();
+                *r = bench_lzss(&c, file, *l - '0', warmup, reps);
+                r->ratio = (double)r->packed / (double)r->size;
+                r->peak_rss_kb = peak_rss_kb(reset);
+                if (ref && ref->enc.p50 > 0 && ref->dec.p50 > 0)
+                {
+                    r->vs_enc = r->enc.p50 / ref->enc.p50;
+                    r->vs_dec = r->dec.p50 / ref->dec.p50;
+                }
+                roundtrip &= r->roundtrip;
+                print_row(r);
+            }
+        }
+        free(raw);
+        free(c.packed);
+        free(c.back);
+    }
+
+    FILE *out = out_path ? xfopen(out_path, "w") : stdout;
+    write_json(out, results, count, max_size, warmup, reps);
+    if (out != stdout)
+        fclose(out);
+
+    int regressions = 0;
+    if (baseline_path)
+    {
+        static Result base[MAX_RESULTS];
+        int base_count = load_baseline(baseline_path, base, MAX_RESULTS);
+        regressions = check_regressions(results, count, base, base_count, speed_tol, ratio_tol);
+        fprintf(stderr, "baseline %s: %d results, %d regression%s (tolerance %.1f%% speedup, %.2f%% ratio)\n",
+                baseline_path, base_count, regressions, regressions == 1 ? "" : "s", speed_tol, ratio_tol);
+    }
+    if (!roundtrip)
+    {
+        fprintf(stderr, "round-trip failed\n");
+        return EXIT_ROUNDTRIP;
+    }
+    return regressions ? EXIT_REGRESSION : 0;
+}
@@ -0,0 +1,34 @@
+// bench_1989.c — Okumura's 1989 LZSS.C as the benchmark baseline
+// The original source is compiled unmodified: its main() is renamed and its
+// progress printf()s are compiled out, so Encode() and Decode() run in-process
+// on whatever FILE*s the benchmark hands them.
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+
+#define main lzss1989_main
+#define printf(...) ((void)0)
+#include "../1989/LZSS.C"
+#undef printf
+#undef main
+
+// Compresses in to out and returns the compressed size. The ring is cleared
+// first, as in a fresh run of the program: near the end of a short input
+// Encode() compares against ring bytes it never wrote.
+size_t lzss1989_encode(FILE *in, FILE *out)
+{
+    infile = in;
+    outfile = out;
+    textsize = codesize = printcount = 0;
+    memset(text_buf, 0, sizeof text_buf);
+    Encode();
+    return (size_t)codesize;
+}
+
+void lzss1989_decode(FILE *in, FILE *out)
+{
+    infile = in;
+    outfile = out;
+    Decode();
+}
@@ -7,8 +7,11 @@
 #   ./build.sh C23 linux       → C23 standard, Linux x64 ELF
 #   ./build.sh CPP23 windows   → C++23 standard, Windows x64 EXE (MSVC runtime) 
 #   ./build.sh CPP23 linux     → C++23 standard, Linux x64 ELF
-#   ./build.sh ASM windows     → Assembly optimized, Windows x64 EXE
-#   ./build.sh ASM linux       → Assembly optimized, Linux x64 ELF
+#   ./build.sh ASM windows     → SIMD kernels with CPUID dispatch, Windows x64 EXE
+#   ./build.sh ASM linux       → SIMD kernels with CPUID dispatch, Linux x64 ELF
+#   ./build.sh BENCH linux     → lzss-bench: library benchmark against 1989/LZSS.C
+#
+# Everything is written to build/, so a build never touches tracked files.
 
 set -e
 
@@ -26,19 +29,33 @@ setup_build_config() {
     case "$BUILD_MODE" in
         C23)
             SRC_FILE="lzss.c"
+            LIB_SRC="lzss_lib.c"  # codec library, also archived as build/liblzss.a
             COMPILER_FLAGS_BASE="-std=c2x -DC_MODE=1"
+            ARCH_FLAGS="-march=native"
             ;;
         CPP23)
-            SRC_FILE="lzss.cpp"  # Will create this
+            SRC_FILE="lzss.cpp"  # header-only codec in lzss.hpp
             COMPILER_FLAGS_BASE="-std=c++2b -DCPP_MODE=1"
+            ARCH_FLAGS="-march=native"
             ;;
         ASM)
-            SRC_FILE="lzss_asm.c"  # Will create this with inline asm
-            COMPILER_FLAGS_BASE="-std=c2x -DASM_MODE=1 -masm=intel"
+            SRC_FILE="lzss.c"
+            LIB_SRC="lzss_lib.c"
+            COMPILER_FLAGS_BASE="-std=c2x -DASM_MODE=1"
+            # Baseline x86-64 only: the library picks SSE2/SSSE3/AVX2 kernels
+            # at run time, so the binary runs on any x86-64 host.
+            ARCH_FLAGS=""
+            ;;
+        BENCH)
+            SRC_FILE="bench/bench.c"
+            LIB_SRC="lzss_lib.c"
+            EXTRA_SRC="bench/bench_1989.c"  # 1989/LZSS.C, compiled in as the baseline
+            COMPILER_FLAGS_BASE="-std=c2x -DASM_MODE=1"
+            ARCH_FLAGS=""
             ;;
         *)
             echo "ERROR: Unknown build mode '$BUILD_MODE'"
-            echo "Supported modes: C23, CPP23, ASM"
+            echo "Supported modes: C23, CPP23, ASM, BENCH"
             exit 1
             ;;
     esac
@@ -47,11 +64,11 @@ setup_build_config() {
         windows)
             TARGET_TRIPLE="x86_64-pc-windows-msvc"
             WINSDK_BASE="/opt/winsdk"
-            EXE_NAME="lzss-${BUILD_MODE,,}.exe"
+            EXE_NAME="$BUILD_DIR/lzss-${BUILD_MODE,,}.exe"
             ;;
         linux)
             TARGET_TRIPLE="x86_64-unknown-linux-gnu"
-            EXE_NAME="lzss-${BUILD_MODE,,}"
+            EXE_NAME="$BUILD_DIR/lzss-${BUILD_MODE,,}"
             ;;
         *)
             echo "ERROR: Unknown platform '$PLATFORM'"
@@ -100,50 +117,12 @@ setup_winsdk() {
     echo "Windows SDK ready."
 }
 
-# ------------------------------------------------------------------------------
-# Source file generation for different modes
-# ------------------------------------------------------------------------------
-ensure_source_files() {
-    # C++ version (stub for now)
-    if [[ "$BUILD_MODE" == "CPP23" && ! -f "lzss.cpp" ]]; then
-        echo "Creating C++23 stub: lzss.cpp"
-        cat > lzss.cpp << 'EOF'
-// lzss.cpp - C++23 LZSS implementation (STUB)
-#include <iostream>
-#include <cstdlib>
-
-int main(int argc, char* argv[]) {
-    std::cout << "C++23 LZSS implementation - Coming soon!\n";
-    std::cout << "Usage: " << argv[0] << " [e|d] input_file output_file\n";
-    return EXIT_SUCCESS;
-}
-EOF
-    fi
-    
-    # Assembly-optimized version (stub for now)
-    if [[ "$BUILD_MODE" == "ASM" && ! -f "lzss_asm.c" ]]; then
-        echo "Creating Assembly-optimized stub: lzss_asm.c"
-        cat > lzss_asm.c << 'EOF'
-// lzss_asm.c - Assembly-optimized LZSS implementation (STUB)
-#include <stdio.h>
-#include <stdlib.h>
-
-int main(int argc, char* argv[]) {
-    printf("Assembly-optimized LZSS implementation - Coming soon!\n");
-    printf("Usage: %s [e|d] input_file output_file\n", argv[0]);
-    return EXIT_SUCCESS;
-}
-EOF
-    fi
-}
-
 # ------------------------------------------------------------------------------
 # Build: Windows
 # ------------------------------------------------------------------------------
 build_windows() {
     echo "=== Building LZSS ($BUILD_MODE) for Windows x64 ==="
     setup_winsdk
-    ensure_source_files
     
     mkdir -p "$BUILD_DIR"
     
@@ -164,7 +143,7 @@ build_windows() {
         LANG_FLAGS="/std:c2x"
     fi
     
-    # Compile directly to executable (single file project)
+    # Compile directly to executable (CLI, plus the library source when the mode has one)
     set -x
     clang-cl --target="$TARGET_TRIPLE" \
         $LANG_FLAGS /MT /O3 /DNDEBUG /D_MT \
@@ -173,7 +152,7 @@ build_windows() {
         "/imsvc$DETECTED_SDK_INCLUDE/$DETECTED_SDK_VERSION/um" \
         "/imsvc$DETECTED_SDK_INCLUDE/$DETECTED_SDK_VERSION/shared" \
         $COMPILER_FLAGS_BASE \
-        -o "$EXE_NAME" "$SRC_FILE" \
+        -o "$EXE_NAME" "$SRC_FILE" $EXTRA_SRC $LIB_SRC \
         /link \
         /subsystem:console \
         /defaultlib:libcmt \
@@ -194,7 +173,6 @@ build_windows() {
 # ------------------------------------------------------------------------------
 build_linux() {
     echo "=== Building LZSS ($BUILD_MODE) for Linux x64 ==="
-    ensure_source_files
     
     mkdir -p "$BUILD_DIR"
     
@@ -215,11 +193,21 @@ build_linux() {
         LANG_FLAGS="-std=c2x"
     fi
     
-    # Compile directly to executable (single file project)
+    # Library first (when the mode has one), then the executable against it
     set -x
-    $COMPILER $LANG_FLAGS -O3 -DNDEBUG -march=native \
-        $COMPILER_FLAGS_BASE \
-        -o "$EXE_NAME" "$SRC_FILE"
+    if [[ -n "$LIB_SRC" ]]; then
+        $COMPILER $LANG_FLAGS -O3 -DNDEBUG $ARCH_FLAGS \
+            $COMPILER_FLAGS_BASE \
+            -c "$LIB_SRC" -o "$BUILD_DIR/lzss_lib.o"
+        ar rcs "$BUILD_DIR/liblzss.a" "$BUILD_DIR/lzss_lib.o"
+        $COMPILER $LANG_FLAGS -O3 -DNDEBUG $ARCH_FLAGS -pthread \
+            $COMPILER_FLAGS_BASE \
+            -o "$EXE_NAME" "$SRC_FILE" $EXTRA_SRC "$BUILD_DIR/liblzss.a"
+    else
+        $COMPILER $LANG_FLAGS -O3 -DNDEBUG $ARCH_FLAGS -pthread \
+            $COMPILER_FLAGS_BASE \
+            -o "$EXE_NAME" "$SRC_FILE"
+    fi
     set +x
     
     [[ -f "$EXE_NAME" ]] || { echo "ERROR: Build failed for $SRC_FILE"; exit 1; }
@@ -231,7 +219,7 @@ build_linux() {
 # ------------------------------------------------------------------------------
 clean() {
     echo "Cleaning build artifacts..."
-    rm -rf "$BUILD_DIR" lzss-* *.pdb *.exe || true
+    rm -rf "$BUILD_DIR" *.pdb || true
     echo "✅ Clean complete"
 }
 
@@ -248,8 +236,9 @@ elif [[ $# -ne 2 ]]; then
     echo ""
     echo "BUILD_MODE:"
     echo "  C23      - C23 standard implementation (current)"
-    echo "  CPP23    - C++23 implementation (stub)"
-    echo "  ASM      - Assembly-optimized implementation (stub)"
+    echo "  CPP23    - C++23 header-only codec with compile-time dialects"
+    echo "  ASM      - C23 with SIMD kernels and runtime CPU dispatch (portable x86-64)"
+    echo "  BENCH    - Benchmark and regression gate for the library (ASM kernels)"
     echo ""
     echo "PLATFORM:"
     echo "  windows  - Cross-compile Windows x64 EXE (MSVC runtime)"  
@@ -260,6 +249,7 @@ elif [[ $# -ne 2 ]]; then
     echo "  ./build.sh C23 linux       # Build C23 version for Linux"
     echo "  ./build.sh CPP23 windows   # Build C++23 version for Windows" 
     echo "  ./build.sh ASM linux       # Build ASM version for Linux"
+    echo "  ./build.sh BENCH linux     # Build lzss-bench for Linux"
     echo "  ./build.sh clean           # Clean build artifacts"
     echo ""
     exit 1
@@ -1,25 +1,29 @@
-// lzss.c — 7th-Guest–style LZSS (fixed format), C23, binary-safe, GREEDY & CORRECT
-// Tokens per flag byte (LSB-first): 1 = literal (1 byte), 0 = pair (2 bytes).
-// Pair layout: ofs_len = ((distance - 1) << 4) | (length - 3), where distance
-// is the backward match distance in bytes (1..4096). Fixed spec: LENGTH_BITS=4
-// → N=4096, F=16, THR=3. History start at N-F.
+// lzss.c — 7th-Guest–style LZSS (fixed format), C23, binary-safe; greedy, lazy and optimal parsers
+// Command-line front end: files, threads, the framed container, random access
+// and batch mode. The codec itself is the library in lzss_lib.c (API in lzss.h).
 
 #define _CRT_SECURE_NO_WARNINGS
+#define _POSIX_C_SOURCE 200809L
 #include <stdio.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <errno.h>
-
-enum
-{
-    LENGTH_BITS = 4,
-    LENGTH_MASK = (1u << LENGTH_BITS) - 1u, // 0x0F
-    N = 1 << (16 - LENGTH_BITS),            // 4096
-    F = 1 << LENGTH_BITS,                   // 16
-    THR = 3,                                // actual_len = stored + THR
-    N_MASK = N - 1
-};
+#include <time.h>
+#include <threads.h>
+#include <stdatomic.h>
+#include "lzss.h"
+#ifdef _WIN32
+#include <windows.h>
+#include <sys/stat.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 static FILE *xfopen(const char *path, const char *mode)
 {
@@ -32,240 +36,1849 @@ static FILE *xfopen(const char *path, const char *mode)
     return f;
 }
 
-// Find best match strictly in HISTORY (no look-ahead sources).
-// r   = start of look-ahead
-// s   = bytes valid in look-ahead
-// hsz = bytes available in history (0..N)
-static inline void find_best_match_hist_greedy(
-    const uint8_t *ring,
-    uint32_t r,
-    int s,
-    int hsz,
-    int *out_dist,
-    int *out_len)
+static void *xmalloc(size_t n)
+{
+    void *p = malloc(n ? n : 1);
+    if (!p)
+    {
+        fprintf(stderr, "oom\n");
+        exit(1);
+    }
+    return p;
+}
+
+enum
+{
+    N = LZSS_HISTORY,
+    IO_CHUNK = 1 << 16,    // encoder input per fread and output per fwrite
+    DECODE_CHUNK = 1 << 20 // raw decoder output per fwrite
+};
+
+static double now_seconds(void)
 {
-    int max_len = s;
-    int best_len = 0, best_dist = 0;
-    const int max_match = F + THR - 1; // 18
-    if (max_len > max_match)
-        max_len = max_match;
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
 
-    // Scan distances 1..hsz (history only)
-    for (int dist = 1; dist <= hsz; ++dist)
+static lzss_encoder *encoder_new(int level)
+{
+    lzss_encoder *e = lzss_encoder_create(level);
+    if (!e)
+    {
+        fprintf(stderr, "oom\n");
+        exit(1);
+    }
+    return e;
+}
+
+// Encodes in as one raw stream through the library's incremental encoder.
+// Matches never reach into the zeroed history before the first byte, so any
+// 7th-Guest decoder accepts the output.
+static size_t encode(FILE *in, FILE *out, int level, uint64_t *consumed)
+{
+    lzss_encoder *e = encoder_new(level);
+    uint8_t *ibuf = (uint8_t *)xmalloc(IO_CHUNK);
+    uint8_t *obuf = (uint8_t *)xmalloc(IO_CHUNK);
+    size_t have = 0, at = 0, produced = 0;
+    bool eof = false;
+    *consumed = 0;
+    for (lzss_status st = LZSS_OK; st == LZSS_OK;)
     {
-        uint32_t p = (r - (uint32_t)dist) & N_MASK;
-        int L = 0;
-        while (L < max_len)
+        if (at == have && !eof)
         {
-            if (ring[(r + (uint32_t)L) & N_MASK] != ring[(p + (uint32_t)L) & N_MASK])
-                break;
-            ++L;
+            have = fread(ibuf, 1, IO_CHUNK, in);
+            at = 0;
+            eof = have < IO_CHUNK;
+            *consumed += have;
         }
-        if (L > best_len)
+        size_t in_len = have - at, out_len = IO_CHUNK;
+        st = lzss_encoder_run(e, ibuf + at, &in_len, obuf, &out_len, eof);
+        at += in_len;
+        fwrite(obuf, 1, out_len, out);
+        produced += out_len;
+    }
+    free(obuf);
+    free(ibuf);
+    lzss_encoder_destroy(e);
+    return produced;
+}
+
+// Whole input in memory: mapped where the platform allows, else read in bulk.
+typedef struct
+{
+    const uint8_t *data;
+    size_t len;
+    bool mapped;
+} InputFile;
+
+static bool input_open(const char *path, InputFile *f)
+{
+    *f = (InputFile){0};
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED)
+        {
+            posix_madvise(p, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+            *f = (InputFile){.data = (const uint8_t *)p, .len = (size_t)st.st_size, .mapped = true};
+            close(fd);
+            return true;
+        }
+    }
+    close(fd);
+#endif
+    FILE *in = fopen(path, "rb");
+    if (!in)
+        return false;
+    size_t cap = 1 << 16, len = 0;
+    uint8_t *buf = (uint8_t *)xmalloc(cap);
+    for (size_t got; (got = fread(buf + len, 1, cap - len, in)) > 0;)
+    {
+        len += got;
+        if (len == cap)
         {
-            best_len = L;
-            best_dist = dist;
-            if (L == max_len)
-                break;
+            uint8_t *grown = (uint8_t *)realloc(buf, cap *= 2);
+            if (!grown)
+            {
+                fprintf(stderr, "oom\n");
+                exit(1);
+            }
+            buf = grown;
         }
     }
-    if (best_len > s)
-        best_len = s; // EOF safety
-    *out_dist = best_dist;
-    *out_len = best_len;
+    fclose(in);
+    *f = (InputFile){.data = buf, .len = len};
+    return true;
 }
 
-static size_t encode(FILE *in, FILE *out)
+static void input_close(InputFile *f)
 {
-    uint8_t *ring = (uint8_t *)malloc(N);
-    if (!ring)
+#ifndef _WIN32
+    if (f->mapped)
+    {
+        munmap((void *)f->data, f->len);
+        return;
+    }
+#endif
+    free((void *)f->data);
+}
+
+// Decodes a raw stream through the library's incremental decoder, in
+// DECODE_CHUNK pieces. A token cut off by the end of the input ends the
+// stream, as it always has.
+static size_t decode(const uint8_t *src, size_t slen, FILE *out)
+{
+    lzss_decoder *d = lzss_decoder_create();
+    if (!d)
     {
         fprintf(stderr, "oom\n");
         exit(1);
     }
-    memset(ring, 0x00, N); // zeroed history (classic 7G-compatible)
+    uint8_t *buf = (uint8_t *)xmalloc(DECODE_CHUNK);
+    size_t produced = 0;
+    for (lzss_status st = LZSS_OK; st == LZSS_OK;)
+    {
+        size_t in_len = slen, out_len = DECODE_CHUNK;
+        st = lzss_decoder_run(d, src, &in_len, buf, &out_len, true);
+        src += in_len;
+        slen -= in_len;
+        fwrite(buf, 1, out_len, out);
+        produced += out_len;
+    }
+    free(buf);
+    lzss_decoder_destroy(d);
+    return produced;
+}
+
+// ----------------------------------------------------------------------------
+// Framed container: independent blocks, compressed and decompressed in
+// parallel. Raw .lzs stays the default. A raw stream may begin with the magic
+// too, so `d`, `i` and `x` take the input as a container only when the whole
+// header is one the encoder could have written for it (see frame_probe()).
+//
+//   0   "LZSB"
+//   4   u8  version (1)
+//   5   u8  reserved (0)
+//   6   u16 dictionary length (0..N)
+//   8   u32 block size
+//   12  u32 block count
+//   16  u64 raw size
+//   24  dictionary bytes
+//   ..  block index: u32 packed size, u32 raw size per block
+//   ..  packed blocks, in order
+//
+// Integers are little-endian. Every block is a plain stream whose history is
+// the dictionary (zeros when it is empty), so with no dictionary each block
+// also decodes on its own with decode().
+// ----------------------------------------------------------------------------
+
+enum
+{
+    FRAME_VERSION = 1,
+    FRAME_HEADER = 24,
+    FRAME_ENTRY = 8,
+    FRAME_BLOCK_DEFAULT = 1 << 20,
+    FRAME_BATCH = 4, // blocks in flight per thread
+    MAX_THREADS = 64
+};
 
-    uint32_t rpos = (uint32_t)(N - F); // start of look-ahead
-    int s = 0;                         // look-ahead size
-    int hsz = 0;                       // bytes in history (0..N)
+static const uint8_t FRAME_MAGIC[4] = {'L', 'Z', 'S', 'B'};
 
-    // Prime look-ahead ONLY
-    while (s < F)
+typedef struct
+{
+    int threads;
+    uint32_t block_size;
+    uint8_t dict[N];
+    size_t dict_len;
+} FrameOptions;
+
+// One batch of blocks shared by the workers; blocks are claimed through next.
+typedef struct
+{
+    int count;
+    atomic_int next;
+    size_t slot_raw;       // stride of raw[]
+    size_t slot_packed;    // encode: stride of packed[]
+    uint8_t *raw;
+    uint8_t *packed;       // encode: output slots
+    const uint8_t *stream; // decode: the whole container
+    size_t *packed_off;    // decode: offset of each block in stream
+    uint32_t *raw_len;
+    uint32_t *packed_len;
+    size_t dict_len;
+    atomic_bool failed;
+} Batch;
+
+typedef struct
+{
+    Batch *batch;
+    lzss_encoder *enc;
+} Worker;
+
+static inline void put_u16(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+static inline void put_u64(uint8_t *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint32_t get_u16(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | get_u16(p + 2) << 16;
+}
+
+static inline uint64_t get_u64(const uint8_t *p)
+{
+    return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+static int cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    long n = (long)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return n < 1 ? 1 : n > MAX_THREADS ? MAX_THREADS : (int)n;
+}
+
+static uint64_t file_size(FILE *f)
+{
+#ifdef _WIN32
+    _fseeki64(f, 0, SEEK_END);
+    int64_t n = _ftelli64(f);
+    _fseeki64(f, 0, SEEK_SET);
+#else
+    fseeko(f, 0, SEEK_END);
+    int64_t n = (int64_t)ftello(f);
+    fseeko(f, 0, SEEK_SET);
+#endif
+    return n < 0 ? 0 : (uint64_t)n;
+}
+
+// Runs fn once per worker, the calling thread taking workers[0]. Work is
+// claimed from the batch, so a worker that fails to start costs only speed.
+// workers is an array of size-byte worker structs.
+static void run_workers(int threads, thrd_start_t fn, void *workers, size_t size)
+{
+    thrd_t tid[MAX_THREADS];
+    bool started[MAX_THREADS] = {false};
+    for (int t = 1; t < threads; ++t)
+        started[t] = thrd_create(&tid[t], fn, (char *)workers + (size_t)t * size) == thrd_success;
+    fn(workers);
+    for (int t = 1; t < threads; ++t)
+        if (started[t])
+            thrd_join(tid[t], NULL);
+}
+
+// Worker threads that live as long as one container and run fn on their
+// worker once per round, so a batch costs a wake-up rather than a thread
+// start. The caller starts a round, is free to read or write while it runs,
+// then takes workers[0] itself in pool_finish().
+typedef struct Pool Pool;
+
+typedef struct
+{
+    Pool *pool;
+    int t;
+} PoolSlot;
+
+struct Pool
+{
+    thrd_start_t fn;
+    char *workers; // array of size-byte worker structs
+    size_t size;
+    int threads;
+    int started;   // pool threads running, workers[1..started]
+    int running;   // pool threads still in the current round
+    unsigned round;
+    bool quit;
+    mtx_t lock;
+    cnd_t wake;
+    cnd_t idle;
+    thrd_t tid[MAX_THREADS];
+    PoolSlot slot[MAX_THREADS];
+};
+
+static int pool_thread(void *arg)
+{
+    PoolSlot *s = (PoolSlot *)arg;
+    Pool *p = s->pool;
+    unsigned seen = 0;
+    mtx_lock(&p->lock);
+    for (;;)
     {
-        int ch = fgetc(in);
-        if (ch == EOF)
+        while (p->round == seen && !p->quit)
+            cnd_wait(&p->wake, &p->lock);
+        if (p->quit)
             break;
-        ring[(rpos + (uint32_t)s) & N_MASK] = (uint8_t)ch;
-        ++s;
+        seen = p->round;
+        mtx_unlock(&p->lock);
+        p->fn(p->workers + (size_t)s->t * p->size);
+        mtx_lock(&p->lock);
+        if (--p->running == 0)
+            cnd_signal(&p->idle);
+    }
+    mtx_unlock(&p->lock);
+    return 0;
+}
+
+// Work is claimed from the batch, so a thread that fails to start costs only
+// speed.
+static void pool_start(Pool *p, int threads, thrd_start_t fn, void *workers, size_t size)
+{
+    p->fn = fn;
+    p->workers = (char *)workers;
+    p->size = size;
+    p->threads = threads;
+    p->started = 0;
+    p->running = 0;
+    p->round = 0;
+    p->quit = false;
+    mtx_init(&p->lock, mtx_plain);
+    cnd_init(&p->wake);
+    cnd_init(&p->idle);
+    for (int t = 1; t < threads; ++t)
+    {
+        PoolSlot *s = &p->slot[p->started];
+        *s = (PoolSlot){.pool = p, .t = p->started + 1};
+        if (thrd_create(&p->tid[p->started], pool_thread, s) == thrd_success)
+            p->started++;
+    }
+}
+
+static void pool_begin(Pool *p)
+{
+    mtx_lock(&p->lock);
+    p->running = p->started;
+    p->round++;
+    cnd_broadcast(&p->wake);
+    mtx_unlock(&p->lock);
+}
+
+static void pool_finish(Pool *p)
+{
+    p->fn(p->workers);
+    mtx_lock(&p->lock);
+    while (p->running > 0)
+        cnd_wait(&p->idle, &p->lock);
+    mtx_unlock(&p->lock);
+}
+
+static void pool_stop(Pool *p)
+{
+    mtx_lock(&p->lock);
+    p->quit = true;
+    cnd_broadcast(&p->wake);
+    mtx_unlock(&p->lock);
+    for (int t = 0; t < p->started; ++t)
+        thrd_join(p->tid[t], NULL);
+    cnd_destroy(&p->idle);
+    cnd_destroy(&p->wake);
+    mtx_destroy(&p->lock);
+}
+
+static int frame_encode_worker(void *arg)
+{
+    Worker *w = (Worker *)arg;
+    Batch *b = w->batch;
+    for (int i; (i = atomic_fetch_add(&b->next, 1)) < b->count;)
+    {
+        // Each raw slot holds N bytes of room for the dictionary, then the block.
+        const uint8_t *src = b->raw + (size_t)i * b->slot_raw + N;
+        int64_t n = lzss_compress_ctx(w->enc, src, b->raw_len[i], b->dict_len, b->packed + (size_t)i * b->slot_packed,
+                                      b->slot_packed);
+        b->packed_len[i] = n < 0 ? 0 : (uint32_t)n;
+        if (n < 0)
+            atomic_store(&b->failed, true);
     }
-    if (s == 0)
+    return 0;
+}
+
+static int frame_decode_worker(void *arg)
+{
+    Batch *b = ((Worker *)arg)->batch;
+    for (int i; (i = atomic_fetch_add(&b->next, 1)) < b->count;)
     {
-        free(ring);
+        int64_t n = lzss_decompress_hist(b->stream + b->packed_off[i], b->packed_len[i],
+                                         b->raw + (size_t)i * b->slot_raw + N, b->raw_len[i], N);
+        if (n != (int64_t)b->raw_len[i])
+            atomic_store(&b->failed, true);
+    }
+    return 0;
+}
+
+static bool is_regular(FILE *f)
+{
+#ifdef _WIN32
+    struct _stat64 st;
+    return _fstat64(_fileno(f), &st) == 0 && (st.st_mode & _S_IFMT) == _S_IFREG;
+#else
+    struct stat st;
+    return fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode);
+#endif
+}
+
+// What a command's output path was when it was opened, so that a failed run
+// deletes only the regular file it wrote.
+typedef struct
+{
+    bool regular;
+#ifndef _WIN32
+    dev_t dev;
+    ino_t ino;
+#endif
+} OutputId;
+
+static OutputId output_id(FILE *f)
+{
+    OutputId id = {.regular = is_regular(f)};
+#ifndef _WIN32
+    struct stat st;
+    if (fstat(fileno(f), &st) == 0)
+    {
+        id.dev = st.st_dev;
+        id.ino = st.st_ino;
+    }
+#endif
+    return id;
+}
+
+// Deletes a failed output, but never a device such as /dev/null, a pipe, or a
+// symbolic link whose target was written through: only the regular file that
+// was opened, if path still names it.
+static void output_discard(const char *path, const OutputId *id)
+{
+    if (!id->regular)
+        return;
+#ifdef _WIN32
+    DWORD attr = GetFileAttributesA(path);
+    if (attr == INVALID_FILE_ATTRIBUTES || (attr & FILE_ATTRIBUTE_REPARSE_POINT) != 0)
+        return;
+#else
+    struct stat st;
+    if (lstat(path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_dev != id->dev || st.st_ino != id->ino)
+        return;
+#endif
+    remove(path);
+}
+
+static bool write_all(FILE *out, const void *data, size_t len)
+{
+    if (fwrite(data, 1, len, out) == len)
+        return true;
+    fprintf(stderr, "write error: %s\n", strerror(errno));
+    return false;
+}
+
+// Reads the next batch of blocks, up to per_batch. Every block but the last
+// must come back full: the header already holds the size.
+static bool frame_read_batch(FILE *in, Batch *b, int per_batch, uint32_t block_size, uint64_t raw_size,
+                             uint64_t *consumed)
+{
+    uint64_t left = (raw_size - *consumed + block_size - 1) / block_size;
+    b->count = (int)(left < (uint64_t)per_batch ? left : (uint64_t)per_batch);
+    for (int i = 0; i < b->count; ++i)
+    {
+        uint64_t want = raw_size - *consumed < block_size ? raw_size - *consumed : block_size;
+        b->raw_len[i] = (uint32_t)fread(b->raw + (size_t)i * b->slot_raw + N, 1, (size_t)want, in);
+        *consumed += b->raw_len[i];
+        if (b->raw_len[i] != want)
+        {
+            fprintf(stderr, "input shrank while being read\n");
+            b->count = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Starts compressing or decompressing b on the pool.
+static void frame_begin(Pool *pool, Worker *workers, Batch *b)
+{
+    for (int t = 0; t < pool->threads; ++t)
+        workers[t].batch = b;
+    atomic_store(&b->next, 0);
+    atomic_store(&b->failed, false);
+    pool_begin(pool);
+}
+
+// Writes the container. Needs a regular file as input, whose size goes in the
+// header, and a seekable output: the block index is written after the blocks
+// it describes. Two batches alternate, so the next batch is read and the
+// previous one written while the pool compresses. Returns the bytes written,
+// or 0 with a message.
+static size_t frame_encode(FILE *in, FILE *out, int level, const FrameOptions *opt, uint64_t *consumed)
+{
+    *consumed = 0;
+    if (!is_regular(in))
+    {
+        fprintf(stderr, "container input must be a regular file: its size goes in the header\n");
         return 0;
     }
+    uint64_t raw_size = file_size(in);
+    uint64_t blocks = (raw_size + opt->block_size - 1) / opt->block_size;
+    if (blocks > UINT32_MAX)
+    {
+        fprintf(stderr, "input too large for block size %u\n", opt->block_size);
+        exit(1);
+    }
 
-    uint8_t block[1 + 2 * 8];
-    uint8_t flags = 0, mask = 1;
-    int bidx = 1;
-    block[0] = 0;
-    size_t produced = 0;
+    uint8_t header[FRAME_HEADER];
+    memcpy(header, FRAME_MAGIC, 4);
+    header[4] = FRAME_VERSION;
+    header[5] = 0;
+    put_u16(header + 6, (uint32_t)opt->dict_len);
+    put_u32(header + 8, opt->block_size);
+    put_u32(header + 12, (uint32_t)blocks);
+    put_u64(header + 16, raw_size);
+    uint8_t *index = (uint8_t *)xmalloc((size_t)blocks * FRAME_ENTRY);
+    memset(index, 0, (size_t)blocks * FRAME_ENTRY);
+    bool ok = write_all(out, header, FRAME_HEADER) && write_all(out, opt->dict, opt->dict_len) &&
+              write_all(out, index, (size_t)blocks * FRAME_ENTRY);
+    size_t produced = FRAME_HEADER + opt->dict_len + (size_t)blocks * FRAME_ENTRY;
 
-    while (s > 0)
+    // Neither the batches nor the pool grow past the blocks there are.
+    int threads = opt->threads;
+    if ((uint64_t)threads > blocks)
+        threads = blocks ? (int)blocks : 1;
+    int per_batch = threads * FRAME_BATCH;
+    if ((uint64_t)per_batch > blocks)
+        per_batch = blocks ? (int)blocks : 1;
+    Batch batches[2];
+    for (int k = 0; k < 2; ++k)
     {
-        int dist = 0, mlen = 0;
-        find_best_match_hist_greedy(ring, rpos, s, hsz, &dist, &mlen);
+        Batch *b = &batches[k];
+        *b = (Batch){.slot_raw = N + opt->block_size, .slot_packed = lzss_bound(opt->block_size)};
+        b->raw = (uint8_t *)xmalloc(b->slot_raw * (size_t)per_batch);
+        b->packed = (uint8_t *)xmalloc(b->slot_packed * (size_t)per_batch);
+        b->raw_len = (uint32_t *)xmalloc(sizeof(uint32_t) * (size_t)per_batch);
+        b->packed_len = (uint32_t *)xmalloc(sizeof(uint32_t) * (size_t)per_batch);
+        b->dict_len = opt->dict_len;
+        for (int i = 0; i < per_batch; ++i)
+            memcpy(b->raw + (size_t)i * b->slot_raw + N - opt->dict_len, opt->dict, opt->dict_len);
+    }
 
-        // Pure greedy: encode match if it beats literal threshold, else literal
-        if (mlen > THR)
+    Worker workers[MAX_THREADS];
+    for (int t = 0; t < threads; ++t)
+        workers[t] = (Worker){.enc = encoder_new(level)};
+    Pool pool;
+    pool_start(&pool, threads, frame_encode_worker, workers, sizeof workers[0]);
+
+    Batch *cur = &batches[0], *next = &batches[1];
+    uint64_t done = 0;
+    cur->count = 0;
+    if (ok)
+        ok = frame_read_batch(in, cur, per_batch, opt->block_size, raw_size, consumed);
+    if (cur->count > 0)
+        frame_begin(&pool, workers, cur);
+    while (cur->count > 0)
+    {
+        next->count = 0;
+        if (ok)
+            ok = frame_read_batch(in, next, per_batch, opt->block_size, raw_size, consumed);
+        pool_finish(&pool);
+        if (ok && atomic_load(&cur->failed))
         {
-            int len_field = mlen - THR; // 0..15
-            if (dist <= 0)
-                dist = 1;                               // safety
-            uint32_t dist_field = (uint32_t)(dist - 1); // store as 0..4095
-            uint16_t ofs_len = (uint16_t)(((dist_field & N_MASK) << LENGTH_BITS) | (uint32_t)(len_field & LENGTH_MASK));
-            block[bidx++] = (uint8_t)(ofs_len & 0xFF);
-            block[bidx++] = (uint8_t)(ofs_len >> 8);
+            fprintf(stderr, "cannot compress block\n");
+            ok = false;
         }
-        else
+        if (next->count > 0)
+            frame_begin(&pool, workers, next);
+        for (int i = 0; ok && i < cur->count; ++i)
+        {
+            ok = write_all(out, cur->packed + (size_t)i * cur->slot_packed, cur->packed_len[i]);
+            put_u32(index + (size_t)(done + (uint64_t)i) * FRAME_ENTRY, cur->packed_len[i]);
+            put_u32(index + (size_t)(done + (uint64_t)i) * FRAME_ENTRY + 4, cur->raw_len[i]);
+            produced += cur->packed_len[i];
+        }
+        done += (uint64_t)cur->count;
+        Batch *written = cur;
+        cur = next;
+        next = written;
+        if (!ok && cur->count > 0)
         {
-            // literal
-            flags |= mask;
-            block[bidx++] = ring[rpos];
-            mlen = 1;
+            pool_finish(&pool);
+            cur->count = 0;
         }
+    }
+    pool_stop(&pool);
+
+    if (ok && fseek(out, (long)(FRAME_HEADER + opt->dict_len), SEEK_SET) != 0)
+    {
+        fprintf(stderr, "container output must be seekable\n");
+        ok = false;
+    }
+    ok = ok && write_all(out, index, (size_t)blocks * FRAME_ENTRY);
+
+    for (int t = 0; t < threads; ++t)
+        lzss_encoder_destroy(workers[t].enc);
+    for (int k = 0; k < 2; ++k)
+    {
+        free(batches[k].packed_len);
+        free(batches[k].raw_len);
+        free(batches[k].packed);
+        free(batches[k].raw);
+    }
+    free(index);
+    return ok ? produced : 0;
+}
+
+static bool frame_corrupt(const char *what)
+{
+    fprintf(stderr, "corrupt container: %s\n", what);
+    return false;
+}
+
+// A container's header and block index, checked against its length.
+typedef struct
+{
+    const uint8_t *dict;
+    const uint8_t *index;
+    uint32_t dict_len;
+    uint32_t block_size;
+    uint32_t blocks;
+    uint64_t raw_size;
+    size_t data_at; // first packed block
+} Frame;
+
+// Reads the header without complaint. A raw stream may well start with 'L',
+// so the input counts as a container only if the whole header is one the
+// encoder could have written for this length; anything else is decoded raw.
+static bool frame_probe(const uint8_t *src, size_t len, Frame *f)
+{
+    if (len < FRAME_HEADER || memcmp(src, FRAME_MAGIC, 4) != 0 || src[4] != FRAME_VERSION || src[5] != 0)
+        return false;
+    *f = (Frame){.dict = src + FRAME_HEADER,
+                 .dict_len = get_u16(src + 6),
+                 .block_size = get_u32(src + 8),
+                 .blocks = get_u32(src + 12),
+                 .raw_size = get_u64(src + 16)};
+    if (f->dict_len > N || f->block_size == 0 ||
+        f->blocks != (f->raw_size + f->block_size - 1) / f->block_size)
+        return false;
+    f->index = f->dict + f->dict_len;
+    uint64_t data_at = FRAME_HEADER + (uint64_t)f->dict_len + (uint64_t)f->blocks * FRAME_ENTRY;
+    if (data_at > len)
+        return false;
+    f->data_at = (size_t)data_at;
+    return true;
+}
+
+static bool frame_open(const uint8_t *src, size_t len, Frame *f)
+{
+    if (!frame_probe(src, len, f))
+        return frame_corrupt("bad header");
+
+    uint64_t total_raw = 0, total_packed = 0;
+    for (uint32_t i = 0; i < f->blocks; ++i)
+    {
+        uint32_t packed = get_u32(f->index + (size_t)i * FRAME_ENTRY);
+        uint32_t raw = get_u32(f->index + (size_t)i * FRAME_ENTRY + 4);
+        // Only the last block may be short: random access relies on it.
+        bool last = i + 1 == f->blocks;
+        if ((last ? raw > f->block_size : raw != f->block_size) || packed > lzss_bound(raw))
+            return frame_corrupt("bad block index");
+        total_raw += raw;
+        total_packed += packed;
+    }
+    if (total_raw != f->raw_size)
+        return frame_corrupt("bad block index");
+    if (total_packed > len - f->data_at)
+        return frame_corrupt("truncated block data");
+    return true;
+}
+
+// Fills slot[0, N) with a block's history: zeros, then the dictionary.
+static void frame_history(const Frame *f, uint8_t *slot)
+{
+    memset(slot, 0x00, N - f->dict_len);
+    memcpy(slot + N - f->dict_len, f->dict, f->dict_len);
+}
+
+// Lays out the next batch of blocks of f, from block *done on, at *at in src.
+static void frame_fill_batch(const Frame *f, Batch *b, int per_batch, uint32_t *done, size_t *at)
+{
+    uint32_t left = f->blocks - *done;
+    b->count = (int)(left < (uint32_t)per_batch ? left : (uint32_t)per_batch);
+    for (int i = 0; i < b->count; ++i)
+    {
+        b->packed_len[i] = get_u32(f->index + (size_t)(*done + (uint32_t)i) * FRAME_ENTRY);
+        b->raw_len[i] = get_u32(f->index + (size_t)(*done + (uint32_t)i) * FRAME_ENTRY + 4);
+        b->packed_off[i] = *at;
+        *at += b->packed_len[i];
+    }
+    *done += (uint32_t)b->count;
+}
 
-        for (int i = 0; i < mlen; ++i)
+// Decodes a container held in memory. Blocks are decoded straight from src;
+// each batch is written while the pool decodes the next. Returns the raw
+// bytes written, or 0 with a message on malformed input.
+static size_t frame_decode(const uint8_t *src, size_t len, FILE *out, int threads)
+{
+    Frame f;
+    if (!frame_open(src, len, &f))
+        return 0;
+
+    // Neither the batches nor the pool grow past the blocks there are.
+    if ((uint32_t)threads > f.blocks)
+        threads = f.blocks ? (int)f.blocks : 1;
+    int per_batch = threads * FRAME_BATCH;
+    if ((uint32_t)per_batch > f.blocks)
+        per_batch = f.blocks ? (int)f.blocks : 1;
+    // Each raw slot is N bytes of history (zeros, then the dictionary), the
+    // block. Decoding never writes the history, so it is set once.
+    Batch batches[2];
+    for (int k = 0; k < 2; ++k)
+    {
+        Batch *b = &batches[k];
+        *b = (Batch){.slot_raw = N + (size_t)f.block_size, .stream = src};
+        b->raw = (uint8_t *)xmalloc(b->slot_raw * (size_t)per_batch);
+        b->packed_off = (size_t *)xmalloc(sizeof(size_t) * (size_t)per_batch);
+        b->raw_len = (uint32_t *)xmalloc(sizeof(uint32_t) * (size_t)per_batch);
+        b->packed_len = (uint32_t *)xmalloc(sizeof(uint32_t) * (size_t)per_batch);
+        for (int i = 0; i < per_batch; ++i)
+            frame_history(&f, b->raw + (size_t)i * b->slot_raw);
+    }
+    Worker workers[MAX_THREADS];
+    Pool pool;
+    pool_start(&pool, threads, frame_decode_worker, workers, sizeof workers[0]);
+
+    bool ok = true;
+    size_t produced = 0;
+    size_t at = f.data_at;
+    uint32_t done = 0;
+    Batch *cur = &batches[0], *next = &batches[1];
+    frame_fill_batch(&f, cur, per_batch, &done, &at);
+    if (cur->count > 0)
+        frame_begin(&pool, workers, cur);
+    while (cur->count > 0)
+    {
+        frame_fill_batch(&f, next, per_batch, &done, &at);
+        pool_finish(&pool);
+        if (atomic_load(&cur->failed))
         {
-            if (hsz < N)
-                ++hsz;
+            ok = frame_corrupt("bad block stream");
+            break;
+        }
+        if (next->count > 0)
+            frame_begin(&pool, workers, next);
+        for (int i = 0; ok && i < cur->count; ++i)
+        {
+            ok = write_all(out, cur->raw + (size_t)i * cur->slot_raw + N, cur->raw_len[i]);
+            produced += cur->raw_len[i];
+        }
+        Batch *written = cur;
+        cur = next;
+        next = written;
+        if (!ok && cur->count > 0)
+        {
+            pool_finish(&pool);
+            cur->count = 0;
+        }
+    }
+    pool_stop(&pool);
 
-            int ch = fgetc(in);
-            if (ch != EOF)
-            {
-                // Append at tail: rpos + s (current s)
-                ring[(rpos + (uint32_t)s) & N_MASK] = (uint8_t)ch;
-                // s remains the same: we are replacing the consumed byte
-            }
-            else
-            {
-                // No new byte → lookahead shrinks
-                if (s > 0)
-                    --s;
-            }
+    for (int k = 0; k < 2; ++k)
+    {
+        free(batches[k].packed_len);
+        free(batches[k].raw_len);
+        free(batches[k].packed_off);
+        free(batches[k].raw);
+    }
+    return ok ? produced : 0;
+}
 
-            rpos = (rpos + 1u) & N_MASK;
+// Writes raw bytes [offset, offset + n) of a container, decoding only the
+// blocks that hold them. *written is the bytes written; returns false, with a
+// message, if the container is malformed.
+static bool frame_extract(const uint8_t *src, size_t len, uint64_t offset, uint64_t n, FILE *out, size_t *written)
+{
+    Frame f;
+    *written = 0;
+    if (!frame_open(src, len, &f))
+        return false;
+    if (offset >= f.raw_size)
+        return true;
+    if (n > f.raw_size - offset)
+        n = f.raw_size - offset;
 
-            if (ch == EOF && s == 0)
-                break;
+    // Every block but the last holds exactly block_size bytes.
+    uint32_t first = (uint32_t)(offset / f.block_size);
+    size_t at = f.data_at;
+    for (uint32_t i = 0; i < first; ++i)
+        at += get_u32(f.index + (size_t)i * FRAME_ENTRY);
+    uint8_t *slot = (uint8_t *)xmalloc(N + (size_t)f.block_size);
+    frame_history(&f, slot);
+    bool ok = true;
+    size_t produced = 0;
+    uint64_t skip = offset - (uint64_t)first * f.block_size;
+    for (uint32_t i = first; i < f.blocks && produced < n; ++i)
+    {
+        uint32_t packed = get_u32(f.index + (size_t)i * FRAME_ENTRY);
+        uint32_t raw = get_u32(f.index + (size_t)i * FRAME_ENTRY + 4);
+        int64_t got = lzss_decompress_hist(src + at, packed, slot + N, raw, N);
+        if (got != (int64_t)raw || skip > (uint64_t)got)
+        {
+            ok = frame_corrupt("bad block stream");
+            break;
         }
+        size_t avail = (size_t)got - (size_t)skip;
+        size_t take = avail < n - produced ? avail : (size_t)(n - produced);
+        if (!write_all(out, slot + N + skip, take))
+        {
+            ok = false;
+            break;
+        }
+        produced += take;
+        at += packed;
+        skip = 0;
+    }
+    free(slot);
+    *written = produced;
+    return ok;
+}
+
+// Builds the checkpoint index of a raw stream. Returns the index size.
+static size_t index_write(const uint8_t *src, size_t len, uint32_t interval, FILE *out)
+{
+    size_t cap = lzss_index_bound(lzss_raw_size(src, len), interval);
+    uint8_t *index = (uint8_t *)xmalloc(cap);
+    int64_t n = lzss_index_build(src, len, interval, index, cap);
+    if (n < 0)
+    {
+        fprintf(stderr, "index: error %lld\n", (long long)n);
+        exit(1);
+    }
+    fwrite(index, 1, (size_t)n, out);
+    free(index);
+    return (size_t)n;
+}
 
-        // Flush every 8 tokens
-        mask <<= 1;
-        if (mask == 0)
+// Writes raw bytes [offset, offset + n) of a raw stream, DECODE_CHUNK at a
+// time, each piece starting from its nearest checkpoint. *written is the bytes
+// written; returns false, with a message, if the index does not fit the stream.
+static bool stream_extract(const uint8_t *src, size_t len, const InputFile *index, uint64_t offset, uint64_t n,
+                           FILE *out, size_t *written)
+{
+    uint8_t *buf = (uint8_t *)xmalloc(DECODE_CHUNK);
+    bool ok = true;
+    size_t produced = 0;
+    while (produced < n)
+    {
+        size_t want = n - produced < DECODE_CHUNK ? (size_t)(n - produced) : DECODE_CHUNK;
+        int64_t got = lzss_extract(src, len, index->data, index->len, offset + produced, buf, want);
+        if (got < 0)
+        {
+            fprintf(stderr, "extract: %s\n", got == LZSS_E_INDEX ? "index does not match the stream" : "error");
+            ok = false;
+            break;
+        }
+        if (!write_all(out, buf, (size_t)got))
         {
-            block[0] = flags;
-            fwrite(block, 1, (size_t)bidx, out);
-            produced += (size_t)bidx;
-            flags = 0;
-            mask = 1;
-            bidx = 1;
-            block[0] = 0;
+            ok = false;
+            break;
         }
+        produced += (size_t)got;
+        if ((size_t)got < want)
+            break; // end of stream
     }
+    free(buf);
+    *written = produced;
+    return ok;
+}
 
-    // Flush remainder
-    if (mask != 1)
+// Primes the container dictionary with the last N bytes of path.
+static void load_dict(const char *path, FrameOptions *opt)
+{
+    FILE *f = xfopen(path, "rb");
+    uint64_t size = file_size(f);
+    if (size > N)
     {
-        block[0] = flags;
-        fwrite(block, 1, (size_t)bidx, out);
-        produced += (size_t)bidx;
+#ifdef _WIN32
+        _fseeki64(f, (int64_t)(size - N), SEEK_SET);
+#else
+        fseeko(f, (off_t)(size - N), SEEK_SET);
+#endif
     }
+    opt->dict_len = fread(opt->dict, 1, N, f);
+    fclose(f);
+}
 
-    free(ring);
-    return produced;
+// ----------------------------------------------------------------------------
+// Batch mode: every file of a directory tree (or of an @list) in one process.
+// A pool of workers claims files one at a time. Each worker keeps its encoder
+// and its I/O buffers for the whole run and reads and writes every file in
+// one call. `a` writes a mirrored tree of plain .lzs streams or, with -c, one
+// archive; `u` reverses either.
+//
+//   0   "LZSA"
+//   4   u8  version (1)
+//   5   u8  reserved (0)
+//   6   u16 dictionary length (0..N)
+//   8   u32 file count
+//   12  u32 reserved (0)
+//   16  u64 offset of the table of contents
+//   24  dictionary bytes
+//   ..  packed files
+//   ..  table of contents, per file: u64 offset, u64 raw size, u64 packed
+//       size, u16 path length, path ('/'-separated, relative)
+//
+// Integers are little-endian. Every file is a stream whose history is the
+// dictionary, as in the block container. Files are stored in path order, so
+// the same input always gives the same archive.
+// ----------------------------------------------------------------------------
+
+enum
+{
+    ARCHIVE_VERSION = 1,
+    ARCHIVE_HEADER = 24,
+    ARCHIVE_ENTRY = 26, // without the path
+    DICT_SAMPLES = 64   // -D auto: files sampled for the dictionary
+};
+
+static const uint8_t ARCHIVE_MAGIC[4] = {'L', 'Z', 'S', 'A'};
+
+typedef struct
+{
+    char *path;      // relative to the batch root, '/'-separated
+    uint64_t raw;
+    uint64_t packed;
+    uint64_t at;     // archive: offset of the packed data
+    double secs;     // read, code and write
+    bool failed;
+} BatchFile;
+
+typedef struct
+{
+    BatchFile *files;
+    size_t count;
+    size_t cap;
+} FileList;
+
+typedef struct
+{
+    char mode;            // 'a' or 'u'
+    FileList list;
+    const char *in_root;  // NULL: paths are relative to the working directory
+    const char *out_root; // mirrored tree
+    const uint8_t *src;   // u: the mapped archive
+    FILE *archive;        // a -c: output, written in file order
+    uint64_t archive_at;
+    bool archive_failed;  // a write to archive failed; later files skip it
+    size_t turn;          // a -c: next file to append
+    mtx_t lock;
+    cnd_t turn_done;
+    int level;
+    uint8_t dict[N];
+    size_t dict_len;
+    atomic_size_t next;
+} BatchJob;
+
+typedef struct
+{
+    BatchJob *job;
+    lzss_encoder *enc;
+    uint8_t *in;  // N bytes of history, then the input file
+    size_t in_cap;
+    uint8_t *out; // N bytes of history, then the output file
+    size_t out_cap;
+} BatchWorker;
+
+static char *path_join(const char *dir, const char *name, const char *suffix)
+{
+    size_t len = (dir ? strlen(dir) + 1 : 0) + strlen(name) + strlen(suffix) + 1;
+    char *path = (char *)xmalloc(len);
+    snprintf(path, len, "%s%s%s%s", dir ? dir : "", dir ? "/" : "", name, suffix);
+    return path;
+}
+
+static void list_add(FileList *list, const char *path, size_t len)
+{
+    if (list->count == list->cap)
+    {
+        list->cap = list->cap ? list->cap * 2 : 256;
+        BatchFile *grown = (BatchFile *)realloc(list->files, list->cap * sizeof(BatchFile));
+        if (!grown)
+        {
+            fprintf(stderr, "oom\n");
+            exit(1);
+        }
+        list->files = grown;
+    }
+    char *copy = (char *)xmalloc(len + 1);
+    memcpy(copy, path, len);
+    copy[len] = '\0';
+    list->files[list->count++] = (BatchFile){.path = copy};
+}
+
+// Archive paths must stay below the output directory.
+static bool path_safe(const char *path)
+{
+    if (path[0] == '\0' || path[0] == '/' || path[0] == '\\' || strchr(path, ':') != NULL)
+        return false;
+    for (const char *p = path; *p;)
+    {
+        size_t n = strcspn(p, "/\\");
+        if (n == 0 || (n == 2 && p[0] == '.' && p[1] == '.'))
+            return false;
+        p += n + (p[n] ? 1 : 0);
+    }
+    return true;
+}
+
+// Adds every regular file below root/rel, recursively. Symbolic links and
+// other special files are skipped. With suffix, only names ending in it.
+static void list_tree(const char *root, const char *rel, const char *suffix, FileList *list)
+{
+    char *dir = rel ? path_join(root, rel, "") : path_join(NULL, root, "");
+#ifdef _WIN32
+    char *pattern = path_join(dir, "*", "");
+    WIN32_FIND_DATAA fd;
+    HANDLE h = FindFirstFileA(pattern, &fd);
+    free(pattern);
+    if (h == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "open %s: cannot list directory\n", dir);
+        exit(1);
+    }
+    do
+    {
+        const char *name = fd.cFileName;
+        bool is_dir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        bool is_file = !is_dir && (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0;
+        is_dir &= (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0;
+#else
+    DIR *d = opendir(dir);
+    if (!d)
+    {
+        fprintf(stderr, "open %s: %s\n", dir, strerror(errno));
+        exit(1);
+    }
+    for (struct dirent *de; (de = readdir(d)) != NULL;)
+    {
+        const char *name = de->d_name;
+        char *full = path_join(dir, name, "");
+        struct stat st;
+        bool known = lstat(full, &st) == 0;
+        free(full);
+        bool is_dir = known && S_ISDIR(st.st_mode);
+        bool is_file = known && S_ISREG(st.st_mode);
+#endif
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+            continue;
+        char *child = rel ? path_join(rel, name, "") : path_join(NULL, name, "");
+        size_t len = strlen(child), slen = suffix ? strlen(suffix) : 0;
+        if (is_dir)
+            list_tree(root, child, suffix, list);
+        else if (is_file && (!suffix || (len > slen && strcmp(child + len - slen, suffix) == 0)))
+            list_add(list, child, len);
+        free(child);
+#ifdef _WIN32
+    } while (FindNextFileA(h, &fd));
+    FindClose(h);
+#else
+    }
+    closedir(d);
+#endif
+    free(dir);
+}
+
+// Adds the paths of an @list file, one per line. They are used as given and
+// must be relative, as they also name the outputs.
+static void list_file(const char *path, FileList *list)
+{
+    FILE *f = xfopen(path, "rb");
+    char line[4096];
+    while (fgets(line, sizeof line, f))
+    {
+        size_t len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        const char *name = line;
+        while (name[0] == '.' && name[1] == '/')
+            name += 2;
+        if (name[0] == '\0')
+            continue;
+        if (!path_safe(name))
+        {
+            fprintf(stderr, "%s: list paths must be relative and stay below it: %s\n", path, name);
+            exit(1);
+        }
+        list_add(list, name, strlen(name));
+    }
+    fclose(f);
+}
+
+static int file_order(const void *a, const void *b)
+{
+    return strcmp(((const BatchFile *)a)->path, ((const BatchFile *)b)->path);
 }
 
-static size_t decode(FILE *in, FILE *out)
+static bool is_dir(const char *path)
 {
-    uint8_t *ring = (uint8_t *)malloc(N);
-    if (!ring)
+#ifdef _WIN32
+    DWORD attr = GetFileAttributesA(path);
+    return attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+static void make_dir(const char *path)
+{
+#ifdef _WIN32
+    CreateDirectoryA(path, NULL);
+#else
+    mkdir(path, 0777);
+#endif
+}
+
+// Creates root and every directory the files need below it. Runs before the
+// workers start, so they only ever create files.
+static void make_dirs(const char *root, const FileList *list)
+{
+    make_dir(root);
+    for (size_t i = 0; i < list->count; ++i)
+    {
+        char *path = path_join(root, list->files[i].path, "");
+        for (char *p = path + strlen(root) + 1; *p; ++p)
+        {
+            if (*p != '/' && *p != '\\')
+                continue;
+            char c = *p;
+            *p = '\0';
+            make_dir(path);
+            *p = c;
+        }
+        free(path);
+    }
+}
+
+// Makes room for n bytes after the N bytes of history in *buf, keeping the
+// history.
+static void reserve(uint8_t **buf, size_t *cap, size_t n)
+{
+    if (n <= *cap && *buf)
+        return;
+    uint8_t *grown = (uint8_t *)realloc(*buf, N + n);
+    if (!grown)
     {
         fprintf(stderr, "oom\n");
         exit(1);
     }
-    memset(ring, 0x00, N); // zeroed history
+    *buf = grown;
+    *cap = n;
+}
 
-    uint32_t rpos = (uint32_t)(N - F);
-    size_t produced = 0;
+// Reads a whole file into w->in after the history. Returns false if it cannot.
+static bool read_input(BatchWorker *w, const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+    uint64_t size = file_size(f);
+    reserve(&w->in, &w->in_cap, (size_t)size);
+    *len = fread(w->in + N, 1, (size_t)size, f);
+    bool ok = *len == size && ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
 
-    for (;;)
+static bool write_output(const char *path, const uint8_t *data, size_t len)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(data, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
+
+// Appends file i to the archive once every file before it is in.
+static void archive_append(BatchJob *job, size_t i, const uint8_t *data, size_t len)
+{
+    mtx_lock(&job->lock);
+    while (job->turn != i)
+        cnd_wait(&job->turn_done, &job->lock);
+    job->list.files[i].at = job->archive_at;
+    if (!job->archive_failed && !write_all(job->archive, data, len))
+        job->archive_failed = true;
+    job->archive_at += len;
+    job->turn++;
+    cnd_broadcast(&job->turn_done);
+    mtx_unlock(&job->lock);
+}
+
+static int batch_encode_worker(void *arg)
+{
+    BatchWorker *w = (BatchWorker *)arg;
+    BatchJob *job = w->job;
+    for (size_t i; (i = atomic_fetch_add(&job->next, 1)) < job->list.count;)
     {
-        int fb = fgetc(in);
-        if (fb == EOF)
-            break;
-        uint8_t flags = (uint8_t)fb;
+        BatchFile *file = &job->list.files[i];
+        double t0 = now_seconds();
+        char *in_path = path_join(job->in_root, file->path, "");
+        size_t len = 0;
+        int64_t n = LZSS_E_PARAM;
+        if (read_input(w, in_path, &len))
+        {
+            reserve(&w->out, &w->out_cap, lzss_bound(len));
+            n = lzss_compress_ctx(w->enc, w->in + N, len, job->dict_len, w->out + N, w->out_cap);
+        }
+        file->raw = len;
+        file->packed = n < 0 ? 0 : (uint64_t)n;
+        file->failed = n < 0;
+        if (job->archive)
+            archive_append(job, i, w->out + N, (size_t)file->packed);
+        else if (n >= 0)
+        {
+            char *out_path = path_join(job->out_root, file->path, ".lzs");
+            file->failed = !write_output(out_path, w->out + N, (size_t)n);
+            free(out_path);
+        }
+        if (file->failed)
+            fprintf(stderr, "%s: cannot compress\n", in_path);
+        free(in_path);
+        file->secs = now_seconds() - t0;
+    }
+    return 0;
+}
 
-        for (int i = 0; i < 8; ++i, flags >>= 1)
+static int batch_decode_worker(void *arg)
+{
+    BatchWorker *w = (BatchWorker *)arg;
+    BatchJob *job = w->job;
+    for (size_t i; (i = atomic_fetch_add(&job->next, 1)) < job->list.count;)
+    {
+        BatchFile *file = &job->list.files[i];
+        double t0 = now_seconds();
+        char *in_path = NULL;
+        char *out_path = path_join(job->out_root, file->path, "");
+        const uint8_t *src;
+        size_t len;
+        bool ok = true;
+        if (job->src)
         {
-            if (flags & 1)
-            {
-                int ch = fgetc(in);
-                if (ch == EOF)
-                    goto done;
-                fputc(ch, out);
-                ring[rpos] = (uint8_t)ch;
-                rpos = (rpos + 1u) & N_MASK;
-                ++produced;
-            }
-            else
-            {
-                int b0 = fgetc(in), b1 = fgetc(in);
-                if (b0 == EOF || b1 == EOF)
-                    goto done;
-                uint16_t ofs_len = (uint16_t)(b0 | (b1 << 8));
-                uint32_t dist_field = (uint32_t)(ofs_len >> LENGTH_BITS);
-                uint32_t distance = dist_field + 1u;                    // stored value was distance - 1
-                uint32_t len = (uint32_t)(ofs_len & LENGTH_MASK) + THR; // 3..18
-                uint32_t offset = (rpos - distance) & N_MASK;
-
-                for (uint32_t j = 0; j < len; ++j)
-                {
-                    uint8_t v = ring[(offset + j) & N_MASK];
-                    fputc(v, out);
-                    ring[rpos] = v;
-                    rpos = (rpos + 1u) & N_MASK;
-                    ++produced;
-                }
-            }
+            src = job->src + file->at;
+            len = (size_t)file->packed;
         }
+        else
+        {
+            in_path = path_join(job->in_root, file->path, "");
+            out_path[strlen(out_path) - strlen(".lzs")] = '\0';
+            ok = read_input(w, in_path, &len);
+            src = w->in + N;
+            file->packed = len;
+            file->raw = ok ? lzss_raw_size(src, len) : 0;
+        }
+        reserve(&w->out, &w->out_cap, (size_t)file->raw);
+        ok = ok && lzss_decompress_hist(src, len, w->out + N, (size_t)file->raw, job->dict_len) ==
+                       (int64_t)file->raw;
+        ok = ok && write_output(out_path, w->out + N, (size_t)file->raw);
+        if (!ok)
+            fprintf(stderr, "%s: cannot decompress\n", in_path ? in_path : file->path);
+        file->failed = !ok;
+        free(out_path);
+        free(in_path);
+        file->secs = now_seconds() - t0;
     }
-done:
-    free(ring);
-    return produced;
+    return 0;
+}
+
+static void batch_run(BatchJob *job, int threads, thrd_start_t fn)
+{
+    if ((size_t)threads > job->list.count)
+        threads = job->list.count ? (int)job->list.count : 1;
+    mtx_init(&job->lock, mtx_plain);
+    cnd_init(&job->turn_done);
+    atomic_store(&job->next, 0);
+    BatchWorker workers[MAX_THREADS];
+    for (int t = 0; t < threads; ++t)
+    {
+        workers[t] = (BatchWorker){.job = job, .enc = job->mode == 'a' ? encoder_new(job->level) : NULL};
+        // History in front of both buffers: zeros, then the dictionary. The
+        // codec never writes it and growing a buffer keeps it.
+        reserve(&workers[t].in, &workers[t].in_cap, IO_CHUNK);
+        reserve(&workers[t].out, &workers[t].out_cap, IO_CHUNK);
+        for (int b = 0; b < 2; ++b)
+        {
+            uint8_t *buf = b ? workers[t].out : workers[t].in;
+            memset(buf, 0x00, N - job->dict_len);
+            memcpy(buf + N - job->dict_len, job->dict, job->dict_len);
+        }
+    }
+    run_workers(threads, fn, workers, sizeof workers[0]);
+    for (int t = 0; t < threads; ++t)
+    {
+        lzss_encoder_destroy(workers[t].enc);
+        free(workers[t].in);
+        free(workers[t].out);
+    }
+    cnd_destroy(&job->turn_done);
+    mtx_destroy(&job->lock);
+}
+
+// -D auto: the first N / DICT_SAMPLES bytes of up to DICT_SAMPLES files spread
+// over the list. Small files of one kind tend to share their headers.
+static void sample_dict(BatchJob *job)
+{
+    size_t step = job->list.count > DICT_SAMPLES ? job->list.count / DICT_SAMPLES : 1;
+    job->dict_len = 0;
+    for (size_t i = 0; i < job->list.count && job->dict_len + N / DICT_SAMPLES <= N; i += step)
+    {
+        char *path = path_join(job->in_root, job->list.files[i].path, "");
+        FILE *f = fopen(path, "rb");
+        if (f)
+        {
+            job->dict_len += fread(job->dict + job->dict_len, 1, N / DICT_SAMPLES, f);
+            fclose(f);
+        }
+        free(path);
+    }
+}
+
+// Compresses every file of input (a directory, or @list) into a tree below
+// output or, with archive, into the single file output. Returns the number of
+// files that failed; an archive that cannot be written fails every file and is
+// deleted.
+static size_t batch_encode(const char *input, const char *output, bool archive, bool auto_dict, int level,
+                           const FrameOptions *opt, BatchJob *job)
+{
+    *job = (BatchJob){.mode = 'a', .level = level, .out_root = output};
+    if (input[0] == '@' && !is_dir(input))
+        list_file(input + 1, &job->list);
+    else
+    {
+        job->in_root = input;
+        list_tree(input, NULL, NULL, &job->list);
+    }
+    qsort(job->list.files, job->list.count, sizeof(BatchFile), file_order);
+
+    uint8_t header[ARCHIVE_HEADER] = {0};
+    OutputId archive_id = {0};
+    if (archive)
+    {
+        memcpy(job->dict, opt->dict, opt->dict_len);
+        job->dict_len = opt->dict_len;
+        if (auto_dict)
+            sample_dict(job);
+        job->archive = xfopen(output, "wb");
+        archive_id = output_id(job->archive);
+        memcpy(header, ARCHIVE_MAGIC, 4);
+        header[4] = ARCHIVE_VERSION;
+        put_u16(header + 6, (uint32_t)job->dict_len);
+        put_u32(header + 8, (uint32_t)job->list.count);
+        job->archive_failed = !write_all(job->archive, header, ARCHIVE_HEADER) ||
+                              !write_all(job->archive, job->dict, job->dict_len);
+        job->archive_at = ARCHIVE_HEADER + job->dict_len;
+    }
+    else
+        make_dirs(output, &job->list);
+
+    batch_run(job, opt->threads, batch_encode_worker);
+
+    if (archive)
+    {
+        // Files that failed are left out, so unpacking never invents them.
+        uint64_t toc_at = job->archive_at;
+        uint32_t stored = 0;
+        bool ok = !job->archive_failed;
+        for (size_t i = 0; i < job->list.count && ok; ++i)
+        {
+            const BatchFile *file = &job->list.files[i];
+            if (file->failed)
+                continue;
+            uint8_t entry[ARCHIVE_ENTRY];
+            size_t len = strlen(file->path);
+            put_u64(entry, file->at);
+            put_u64(entry + 8, file->raw);
+            put_u64(entry + 16, file->packed);
+            put_u16(entry + 24, (uint32_t)len);
+            ok = write_all(job->archive, entry, ARCHIVE_ENTRY) && write_all(job->archive, file->path, len);
+            ++stored;
+        }
+        put_u32(header + 8, stored);
+        put_u64(header + 16, toc_at);
+        if (ok && fseek(job->archive, 0, SEEK_SET) != 0)
+        {
+            fprintf(stderr, "archive output must be seekable\n");
+            ok = false;
+        }
+        ok = ok && write_all(job->archive, header, ARCHIVE_HEADER);
+        if (fclose(job->archive) != 0 && ok)
+        {
+            fprintf(stderr, "write error: %s\n", strerror(errno));
+            ok = false;
+        }
+        job->archive = NULL;
+        if (!ok)
+        {
+            output_discard(output, &archive_id);
+            for (size_t i = 0; i < job->list.count; ++i)
+                job->list.files[i].failed = true;
+        }
+    }
+
+    size_t failed = 0;
+    for (size_t i = 0; i < job->list.count; ++i)
+        failed += job->list.files[i].failed;
+    return failed;
+}
+
+static bool archive_corrupt(const char *what)
+{
+    fprintf(stderr, "corrupt archive: %s\n", what);
+    return false;
+}
+
+// Reads an archive's dictionary and table of contents into job.
+static bool archive_open(const uint8_t *src, size_t len, BatchJob *job)
+{
+    if (len < ARCHIVE_HEADER || memcmp(src, ARCHIVE_MAGIC, 4) != 0)
+        return archive_corrupt("bad header");
+    if (src[4] != ARCHIVE_VERSION)
+        return archive_corrupt("unknown version");
+    job->dict_len = get_u16(src + 6);
+    uint32_t count = get_u32(src + 8);
+    uint64_t at = get_u64(src + 16);
+    uint64_t data_at = ARCHIVE_HEADER + (uint64_t)job->dict_len;
+    if (job->dict_len > N || at < data_at || at > len)
+        return archive_corrupt("bad header");
+    memcpy(job->dict, src + ARCHIVE_HEADER, job->dict_len);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (len - at < ARCHIVE_ENTRY)
+            return archive_corrupt("truncated table of contents");
+        const uint8_t *entry = src + at;
+        uint64_t offset = get_u64(entry), raw = get_u64(entry + 8), packed = get_u64(entry + 16);
+        size_t path_len = get_u16(entry + 24);
+        at += ARCHIVE_ENTRY;
+        if (len - at < path_len)
+            return archive_corrupt("truncated table of contents");
+        list_add(&job->list, (const char *)src + at, path_len);
+        at += path_len;
+        BatchFile *file = &job->list.files[job->list.count - 1];
+        if (!path_safe(file->path) || strlen(file->path) != path_len)
+            return archive_corrupt("unsafe path");
+        // A stream expands at most 9 times (a flag byte and 8 pairs of 2 bytes
+        // give 8 * 18 bytes), so a larger raw size is never allocated.
+        if (offset < data_at || offset > len || packed > len - offset || packed > lzss_bound((size_t)raw) ||
+            raw > packed * 9 || raw > SIZE_MAX - N)
+            return archive_corrupt("bad table of contents");
+        file->at = offset;
+        file->raw = raw;
+        file->packed = packed;
+    }
+    // Two entries for one path would write it twice, the second over the first.
+    qsort(job->list.files, job->list.count, sizeof(BatchFile), file_order);
+    for (size_t i = 1; i < job->list.count; ++i)
+        if (strcmp(job->list.files[i - 1].path, job->list.files[i].path) == 0)
+            return archive_corrupt("duplicate path");
+    return true;
+}
+
+// Decompresses an archive, or every .lzs file below a directory, into a tree
+// below output. Returns the number of files that failed.
+static size_t batch_decode(const char *input, const char *output, int threads, BatchJob *job)
+{
+    *job = (BatchJob){.mode = 'u', .out_root = output};
+    InputFile in = {0};
+    if (!is_dir(input))
+    {
+        if (!input_open(input, &in))
+        {
+            fprintf(stderr, "open %s: %s\n", input, strerror(errno));
+            exit(1);
+        }
+        if (!archive_open(in.data, in.len, job))
+        {
+            input_close(&in);
+            return 1;
+        }
+        job->src = in.data;
+    }
+    else
+    {
+        job->in_root = input;
+        list_tree(input, NULL, ".lzs", &job->list);
+        qsort(job->list.files, job->list.count, sizeof(BatchFile), file_order);
+    }
+    make_dirs(output, &job->list);
+    batch_run(job, threads, batch_decode_worker);
+    if (in.data)
+        input_close(&in);
+
+    size_t failed = 0;
+    for (size_t i = 0; i < job->list.count; ++i)
+        failed += job->list.files[i].failed;
+    return failed;
+}
+
+static void batch_free(BatchJob *job)
+{
+    for (size_t i = 0; i < job->list.count; ++i)
+        free(job->list.files[i].path);
+    free(job->list.files);
+}
+
+// -v: one line per file, then the totals.
+static void batch_report(const BatchJob *job, double secs, int threads)
+{
+    uint64_t raw = 0, packed = 0;
+    for (size_t i = 0; i < job->list.count; ++i)
+    {
+        const BatchFile *f = &job->list.files[i];
+        raw += f->raw;
+        packed += f->packed;
+        fprintf(stderr, "  %s: %llu -> %llu bytes, ratio %.4f, %.3f ms, %.1f MB/s%s\n", f->path,
+                (unsigned long long)(job->mode == 'a' ? f->raw : f->packed),
+                (unsigned long long)(job->mode == 'a' ? f->packed : f->raw),
+                f->raw ? (double)f->packed / (double)f->raw : 0.0, f->secs * 1e3,
+                f->secs > 0 ? (double)f->raw / f->secs / 1e6 : 0.0, f->failed ? " FAILED" : "");
+    }
+    fprintf(stderr, "%c -t %d [%s]: %zu files, %llu raw / %llu packed bytes, ratio %.4f, %.3f s, %.0f files/s, %.1f MB/s\n",
+            job->mode, threads, lzss_simd_name(lzss_simd()), job->list.count, (unsigned long long)raw,
+            (unsigned long long)packed, raw ? (double)packed / (double)raw : 0.0, secs,
+            secs > 0 ? (double)job->list.count / secs : 0.0, secs > 0 ? (double)raw / secs / 1e6 : 0.0);
+}
+
+static int simd_by_name(const char *name)
+{
+    for (int i = LZSS_SIMD_SCALAR; i <= LZSS_SIMD_AVX2; ++i)
+        if (strcmp(name, lzss_simd_name(i)) == 0)
+            return i;
+    return -1;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "  %s e [-l level] [-m scan|chain] [-c [-t threads] [-b block_kb] [-D dict]] [-k simd] [-v] input output\n"
+            "  %s d [-t threads] [-k simd] [-v] input output\n"
+            "  %s i [-b interval_kb] [-v] input index\n"
+            "  %s x [-i index] [-v] input offset length output\n"
+            "  %s a [-l level] [-c [-D dict|auto]] [-t threads] [-v] directory|@list output\n"
+            "  %s u [-t threads] [-v] archive|directory output_directory\n"
+            "Options:\n"
+            "  -l  1 fast greedy, 2 greedy (default), 3 lazy, 4 optimal\n"
+            "  -m  match finder: chain (default, hash chains) or scan (brute-force reference, -l 2 only)\n"
+            "  -c  write the framed block container instead of a raw stream; a: one archive instead of a tree\n"
+            "  -t  worker threads for -c, for decoding containers and for a/u (default: all cores)\n"
+            "  -b  container block size in KB (default 1024); i: checkpoint interval in KB (default 64)\n"
+            "  -D  prime every container block (a -c: every file) with the last 4 KB of this file;\n"
+            "      a -c -D auto samples the inputs\n"
+            "  -k  cap the SIMD kernels: scalar, sse2, ssse3 or avx2 (default: best the CPU has)\n"
+            "  -i  x: checkpoint index of a raw stream (default: input.idx; containers need none)\n"
+            "  -v  print sizes, ratio, MB/s and kernels to stderr (a/u: per file and in total)\n",
+            prog, prog, prog, prog, prog, prog);
+}
+
+// Parses a decimal (or 0x hexadecimal) byte count or offset.
+static bool parse_u64(const char *text, uint64_t *v)
+{
+    char *end;
+    errno = 0;
+    *v = strtoull(text, &end, 0);
+    return text[0] >= '0' && text[0] <= '9' && *end == '\0' && errno == 0;
 }
 
 int main(int argc, char **argv)
 {
-    if (argc != 4)
+    if (argc < 4)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    char mode = argv[1][0];
+    if (mode == '\0' || strchr("edixau", mode) == NULL)
+    {
+        fprintf(stderr, "mode must be e, d, i, x, a or u\n");
+        return 1;
+    }
+    int positional = mode == 'x' ? 4 : 2;
+
+    bool scan = false;
+    int level = LZSS_LEVEL_DEFAULT;
+    bool verbose = false;
+    bool framed = false;
+    bool block_set = false;
+    bool threads_set = false;
+    bool auto_dict = false;
+    bool dict_set = false;
+    int kernel = -1;
+    const char *index_path = NULL;
+    static FrameOptions frame = {.block_size = FRAME_BLOCK_DEFAULT};
+    frame.threads = cpu_count();
+    int arg = 2;
+    while (arg < argc - positional && argv[arg][0] == '-')
+    {
+        const char *opt = argv[arg];
+        const char *val = argv[arg + 1];
+        if (strcmp(opt, "-v") == 0 || strcmp(opt, "-c") == 0)
+        {
+            verbose |= opt[1] == 'v';
+            framed |= opt[1] == 'c';
+            arg += 1;
+            continue;
+        }
+        char *end;
+        long num = strtol(val, &end, 10);
+        if (end == val || *end != '\0')
+            num = 0; // "4x" is not 4
+        if (strcmp(opt, "-m") == 0 && (strcmp(val, "chain") == 0 || strcmp(val, "scan") == 0))
+            scan = val[0] == 's';
+        else if (strcmp(opt, "-l") == 0 && val[0] >= '0' + LZSS_LEVEL_FAST && val[0] <= '0' + LZSS_LEVEL_OPTIMAL &&
+                 val[1] == '\0')
+            level = val[0] - '0';
+        else if (strcmp(opt, "-t") == 0 && num >= 1 && num <= MAX_THREADS)
+        {
+            frame.threads = (int)num;
+            threads_set = true;
+        }
+        else if (strcmp(opt, "-b") == 0 && num >= 1 && num <= (1 << 20))
+        {
+            frame.block_size = (uint32_t)num << 10;
+            block_set = true;
+        }
+        else if (strcmp(opt, "-D") == 0 && mode == 'a' && strcmp(val, "auto") == 0)
+            auto_dict = dict_set = true;
+        else if (strcmp(opt, "-D") == 0)
+        {
+            load_dict(val, &frame);
+            dict_set = true;
+        }
+        else if (strcmp(opt, "-i") == 0)
+            index_path = val;
+        else if (strcmp(opt, "-k") == 0 && simd_by_name(val) >= 0)
+            kernel = simd_by_name(val);
+        else
+        {
+            fprintf(stderr, "bad option: %s %s\n", opt, val);
+            return 1;
+        }
+        arg += 2;
+    }
+    if (arg != argc - positional)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (scan && level != LZSS_LEVEL_GREEDY)
+    {
+        fprintf(stderr, "-m scan is only available at -l %d\n", LZSS_LEVEL_GREEDY);
+        return 1;
+    }
+    int codec_level = scan ? LZSS_LEVEL_SCAN : level;
+    uint32_t interval = block_set ? frame.block_size : LZSS_INDEX_INTERVAL_DEFAULT;
+    if (mode == 'i' && interval < LZSS_INDEX_INTERVAL_MIN)
+    {
+        fprintf(stderr, "checkpoint interval must be at least %d KB\n", LZSS_INDEX_INTERVAL_MIN >> 10);
+        return 1;
+    }
+    uint64_t offset = 0, length = 0;
+    if (mode == 'x' && (!parse_u64(argv[arg + 1], &offset) || !parse_u64(argv[arg + 2], &length)))
+    {
+        fprintf(stderr, "bad offset or length: %s %s\n", argv[arg + 1], argv[arg + 2]);
+        return 1;
+    }
+    const char *out_path = argv[argc - 1];
+    if (mode == 'e' && !framed && (threads_set || block_set || dict_set))
+    {
+        fprintf(stderr, "-t, -b and -D need -c: a raw stream is written by one thread with no dictionary\n");
+        return 1;
+    }
+    if (mode == 'a' && !framed && dict_set)
+    {
+        fprintf(stderr, "-D needs -c: a mirrored tree holds plain streams\n");
+        return 1;
+    }
+    if (dict_set && mode != 'e' && mode != 'a')
+    {
+        fprintf(stderr, "-D needs e -c or a -c: a container or archive carries its own dictionary\n");
+        return 1;
+    }
+    if (index_path && mode != 'x')
+    {
+        fprintf(stderr, "-i needs x: no other mode reads a checkpoint index\n");
+        return 1;
+    }
+    if (kernel >= 0 && lzss_simd_limit(kernel) != kernel)
     {
-        fprintf(stderr, "Usage:\n  %s e input output\n  %s d input output\n", argv[0], argv[0]);
+        fprintf(stderr, "-k %s: this build runs at most %s on this CPU\n", lzss_simd_name(kernel),
+                lzss_simd_name(lzss_simd()));
         return 1;
     }
-    FILE *in = xfopen(argv[2], "rb");
-    FILE *out = xfopen(argv[3], "wb");
+
+    if (mode == 'a' || mode == 'u')
+    {
+        static BatchJob job;
+        double t0 = now_seconds();
+        size_t failed = mode == 'a' ? batch_encode(argv[arg], out_path, framed, auto_dict, codec_level, &frame, &job)
+                                    : batch_decode(argv[arg], out_path, frame.threads, &job);
+        if (verbose)
+            batch_report(&job, now_seconds() - t0, frame.threads);
+        batch_free(&job);
+        return failed ? 2 : 0;
+    }
+
+    double t0 = now_seconds();
+    uint64_t raw = 0;
     size_t n = 0;
-    if (argv[1][0] == 'e')
-        n = encode(in, out);
-    else if (argv[1][0] == 'd')
-        n = decode(in, out);
-    else
+    bool ok = true;
+    OutputId out_id = {0};
+    if (mode == 'e')
     {
-        fprintf(stderr, "mode must be e or d\n");
+        FILE *in = xfopen(argv[arg], "rb");
+        FILE *out = xfopen(out_path, "wb");
+        out_id = output_id(out);
+        if (framed)
+            n = frame_encode(in, out, codec_level, &frame, &raw);
+        else
+            n = encode(in, out, codec_level, &raw);
         fclose(in);
         fclose(out);
-        return 1;
+        ok = !framed || n > 0;
     }
-    fclose(in);
-    fclose(out);
+    else
+    {
+        InputFile in;
+        if (!input_open(argv[arg], &in))
+        {
+            fprintf(stderr, "open %s: %s\n", argv[arg], strerror(errno));
+            return 1;
+        }
+        Frame probe;
+        bool container = frame_probe(in.data, in.len, &probe);
+        if ((mode == 'i' || index_path) && container)
+        {
+            fprintf(stderr, "%s is a container: its block index already gives random access\n", argv[arg]);
+            return 1;
+        }
+
+        InputFile index = {0};
+        char default_index[4096];
+        if (mode == 'x' && !container)
+        {
+            if (!index_path)
+            {
+                snprintf(default_index, sizeof default_index, "%s.idx", argv[arg]);
+                index_path = default_index;
+            }
+            if (!input_open(index_path, &index))
+            {
+                fprintf(stderr, "open %s: %s (build it with: %s i %s %s)\n", index_path, strerror(errno), argv[0],
+                        argv[arg], index_path);
+                return 1;
+            }
+        }
+
+        FILE *out = xfopen(out_path, "wb");
+        out_id = output_id(out);
+        if (mode == 'i')
+        {
+            raw = lzss_raw_size(in.data, in.len);
+            n = index_write(in.data, in.len, interval, out);
+        }
+        else if (mode == 'x' && container)
+            ok = frame_extract(in.data, in.len, offset, length, out, &n);
+        else if (mode == 'x')
+            ok = stream_extract(in.data, in.len, &index, offset, length, out, &n);
+        else if (container)
+            ok = (n = frame_decode(in.data, in.len, out, frame.threads)) == probe.raw_size;
+        else
+            raw = n = decode(in.data, in.len, out);
+        if (mode != 'i')
+            raw = n;
+        fclose(out);
+        if (index.data)
+            input_close(&index);
+        input_close(&in);
+    }
+    double secs = now_seconds() - t0;
+    if (!ok)
+    {
+        output_discard(out_path, &out_id); // never leave a partial output behind
+        return 2;
+    }
+
+    if (verbose && mode == 'e')
+        fprintf(stderr, "e -l %d (%s)%s [%s]: %llu -> %zu bytes, ratio %.4f, %.3f s, %.1f MB/s\n",
+                level, lzss_level_name(codec_level), framed ? " -c" : "", lzss_simd_name(lzss_simd()),
+                (unsigned long long)raw, n, raw ? (double)n / (double)raw : 0.0, secs,
+                secs > 0 ? (double)raw / secs / 1e6 : 0.0);
+    else if (verbose && mode == 'i')
+        fprintf(stderr, "i -b %u: %llu raw bytes, %zu byte index (%.2f%%), %.3f s\n", interval >> 10,
+                (unsigned long long)raw, n, raw ? 100.0 * (double)n / (double)raw : 0.0, secs);
+    else if (verbose && mode == 'x')
+        fprintf(stderr, "x [%s]: %zu bytes at %llu, %.6f s\n", lzss_simd_name(lzss_simd()), n,
+                (unsigned long long)offset, secs);
+    else if (verbose)
+        fprintf(stderr, "d [%s]: %llu bytes, %.3f s, %.1f MB/s\n", lzss_simd_name(lzss_simd()),
+                (unsigned long long)raw, secs, secs > 0 ? (double)raw / secs / 1e6 : 0.0);
     return (n > 0) ? 0 : 2;
 }
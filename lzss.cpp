@@ -0,0 +1,170 @@
+// lzss.cpp — C++23 command-line front end over lzss.hpp
+// Same e/d interface as lzss.c, plus -f to pick the stream dialect by name.
+// Each dialect is its own instantiation of the templated codec; the name is
+// only looked up once, before any data is touched.
+
+#include "lzss.hpp"
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+std::FILE *xfopen(const char *path, const char *mode)
+{
+    std::FILE *f = std::fopen(path, mode);
+    if (!f)
+    {
+        std::fprintf(stderr, "open %s: %s\n", path, std::strerror(errno));
+        std::exit(1);
+    }
+    return f;
+}
+
+std::vector<std::uint8_t> read_file(const char *path)
+{
+    std::FILE *f = xfopen(path, "rb");
+    std::vector<std::uint8_t> data;
+    std::uint8_t chunk[1 << 16];
+    for (std::size_t got; (got = std::fread(chunk, 1, sizeof chunk, f)) > 0;)
+        data.insert(data.end(), chunk, chunk + got);
+    std::fclose(f);
+    return data;
+}
+
+// Runs one direction of dialect D over in and writes the result to out.
+// Returns the number of bytes written.
+template <class D>
+std::size_t run(char mode, std::span<const std::uint8_t> in, lzss::Level level, std::FILE *out)
+{
+    std::span<const std::uint8_t> result;
+    if (mode == 'e')
+    {
+        lzss::Encoder<D> e(level);
+        result = e.encode(in);
+        std::fwrite(result.data(), 1, result.size(), out);
+    }
+    else
+    {
+        lzss::Decoder<D> d;
+        return static_cast<std::size_t>(
+            d.decode(in, [out](std::span<const std::uint8_t> piece)
+                     { std::fwrite(piece.data(), 1, piece.size(), out); }));
+    }
+    return result.size();
+}
+
+struct DialectEntry
+{
+    std::string_view name;
+    const char *about;
+    std::size_t (*run)(char mode, std::span<const std::uint8_t> in, lzss::Level level, std::FILE *out);
+};
+
+constexpr std::array DIALECTS{
+    DialectEntry{"7thguest", "12/4 split, distances, zeroed history (default; the C build's streams)",
+                 run<lzss::SeventhGuest>},
+    DialectEntry{"7thguest-11-5", "11/5 split: 2 KB window, matches of up to 34 bytes", run<lzss::SeventhGuest11_5>},
+    DialectEntry{"okumura", "1989 LZSS.C: 12/4 split, ring positions, space-filled history", run<lzss::Okumura>},
+};
+
+constexpr std::array<const char *, 5> LEVEL_NAMES{nullptr, "fast", "greedy", "lazy", "optimal"};
+
+const DialectEntry *dialect_by_name(std::string_view name)
+{
+    for (const DialectEntry &d : DIALECTS)
+        if (d.name == name)
+            return &d;
+    return nullptr;
+}
+
+void usage(const char *prog)
+{
+    std::fprintf(stderr,
+                 "Usage:\n"
+                 "  %s e [-f dialect] [-l level] [-v] input output\n"
+                 "  %s d [-f dialect] [-v] input output\n"
+                 "Options:\n"
+                 "  -f  stream dialect (default 7thguest)\n"
+                 "  -l  1 fast greedy, 2 greedy (default), 3 lazy, 4 optimal\n"
+                 "  -v  print sizes, ratio and MB/s to stderr\n"
+                 "Dialects:\n",
+                 prog, prog);
+    for (const DialectEntry &d : DIALECTS)
+        std::fprintf(stderr, "  %-14s %s\n", d.name.data(), d.about);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 4)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    const DialectEntry *dialect = &DIALECTS[0];
+    int level = 2;
+    bool verbose = false;
+    int arg = 2;
+    while (arg < argc - 2 && argv[arg][0] == '-')
+    {
+        std::string_view opt = argv[arg];
+        if (opt == "-v")
+        {
+            verbose = true;
+            arg += 1;
+            continue;
+        }
+        std::string_view val = argv[arg + 1];
+        if (opt == "-f" && dialect_by_name(val))
+            dialect = dialect_by_name(val);
+        else if (opt == "-l" && val.size() == 1 && val[0] >= '1' && val[0] <= '4')
+            level = val[0] - '0';
+        else
+        {
+            std::fprintf(stderr, "bad option: %s %s\n", opt.data(), val.data());
+            return 1;
+        }
+        arg += 2;
+    }
+    if (arg != argc - 2)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    char mode = argv[1][0];
+    if (mode != 'e' && mode != 'd')
+    {
+        std::fprintf(stderr, "mode must be e or d\n");
+        return 1;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::uint8_t> in = read_file(argv[arg]);
+    std::FILE *out = xfopen(argv[arg + 1], "wb");
+    std::size_t n = dialect->run(mode, in, static_cast<lzss::Level>(level), out);
+    std::fclose(out);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::size_t raw = mode == 'e' ? in.size() : n;
+    if (verbose && mode == 'e')
+        std::fprintf(stderr, "e -f %s -l %d (%s): %zu -> %zu bytes, ratio %.4f, %.3f s, %.1f MB/s\n",
+                     dialect->name.data(), level, LEVEL_NAMES[static_cast<std::size_t>(level)], raw, n,
+                     raw ? static_cast<double>(n) / static_cast<double>(raw) : 0.0, secs,
+                     secs > 0 ? static_cast<double>(raw) / secs / 1e6 : 0.0);
+    else if (verbose)
+        std::fprintf(stderr, "d -f %s: %zu bytes, %.3f s, %.1f MB/s\n", dialect->name.data(), raw, secs,
+                     secs > 0 ? static_cast<double>(raw) / secs / 1e6 : 0.0);
+    return (n > 0) ? 0 : 2;
+}
@@ -0,0 +1,154 @@
+// lzss.h — embeddable 7th-Guest–style LZSS codec (see lzss_lib.c for the format)
+//
+// No FILE*, no exit(): every call reports failure through an lzss_status.
+//
+// One-shot:
+//   int64_t n = lzss_compress(src, len, dst, lzss_bound(len), LZSS_LEVEL_DEFAULT);
+//   int64_t m = lzss_decompress(dst, (size_t)n, out, out_cap);
+//
+// Random access: build a checkpoint index once, then extract any range:
+//   size_t cap = lzss_index_bound(lzss_raw_size(src, len), LZSS_INDEX_INTERVAL_DEFAULT);
+//   int64_t ilen = lzss_index_build(src, len, LZSS_INDEX_INTERVAL_DEFAULT, index, cap);
+//   int64_t got = lzss_extract(src, len, index, (size_t)ilen, offset, out, n);
+//
+// Incremental: one context per stream, created once and reused. Each call to
+// lzss_encoder_run() / lzss_decoder_run() consumes any amount of input and
+// produces any amount of output; *in_len and *out_len go in as the sizes
+// available and come back as the sizes used. A context can live in caller
+// memory (lzss_*_size() bytes, aligned for any type) and never allocates.
+
+#ifndef LZSS_H
+#define LZSS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    LZSS_OK = 0,           // progress made; call again
+    LZSS_END = 1,          // stream finished and fully delivered
+    LZSS_E_PARAM = -1,     // bad argument or level
+    LZSS_E_NOMEM = -2,     // allocation failed
+    LZSS_E_DST_SIZE = -3,  // output does not fit in the destination
+    LZSS_E_INDEX = -4      // checkpoint index malformed or made for another stream
+} lzss_status;
+
+enum
+{
+    LZSS_LEVEL_SCAN = 0,    // greedy, brute-force reference match finder (slow)
+    LZSS_LEVEL_FAST = 1,    // greedy, short hash chains
+    LZSS_LEVEL_GREEDY = 2,  // greedy, exhaustive hash chains; same bytes as SCAN
+    LZSS_LEVEL_LAZY = 3,    // one-step lazy matching
+    LZSS_LEVEL_OPTIMAL = 4, // minimum-bit parse per 4 KB window
+    LZSS_LEVEL_DEFAULT = LZSS_LEVEL_GREEDY,
+    LZSS_HISTORY = 4096,    // largest distance, and largest dictionary
+    LZSS_INDEX_INTERVAL_MIN = LZSS_HISTORY,
+    LZSS_INDEX_INTERVAL_DEFAULT = 1 << 16
+};
+
+// Kernel sets, in increasing order. Only the ASM build on x86-64 has more
+// than LZSS_SIMD_SCALAR; every set produces the same bytes.
+enum
+{
+    LZSS_SIMD_SCALAR = 0,
+    LZSS_SIMD_SSE2 = 1,  // 16-byte match compares and 16-distance scans
+    LZSS_SIMD_SSSE3 = 2, // + shuffled short-distance match copies
+    LZSS_SIMD_AVX2 = 3   // + 32-distance scans
+};
+
+typedef struct lzss_encoder lzss_encoder;
+typedef struct lzss_decoder lzss_decoder;
+
+// Worst-case compressed size of len bytes.
+size_t lzss_bound(size_t len);
+
+// Short name of a level ("fast", "greedy", ...), or NULL if out of range.
+const char *lzss_level_name(int level);
+
+// Compresses src into dst. Returns the compressed size or a negative
+// lzss_status. Allocates one encoder for the duration of the call.
+int64_t lzss_compress(const void *src, size_t len, void *dst, size_t cap, int level);
+
+// As lzss_compress(), using e (at the level it was initialised with) and
+// no allocation. The hist bytes before src (at most LZSS_HISTORY) are the
+// stream's history, so the output only decodes with the same history.
+int64_t lzss_compress_ctx(lzss_encoder *e, const void *src, size_t len, size_t hist, void *dst, size_t cap);
+
+// Decompresses a whole stream into dst. Returns the decompressed size or a
+// negative lzss_status. Every byte string is a valid stream; a token cut off
+// by the end of src ends it, as in the original decoder.
+int64_t lzss_decompress(const void *src, size_t len, void *dst, size_t cap);
+
+// As lzss_decompress(), with the hist bytes before dst (at most
+// LZSS_HISTORY) as the stream's history instead of zeros.
+int64_t lzss_decompress_hist(const void *src, size_t len, void *dst, size_t cap, size_t hist);
+
+// Kernel set used by contexts initialised from now on: the best the CPU
+// supports, detected on first use.
+int lzss_simd(void);
+
+// Caps the kernel set at max and returns the set now in use. For benchmarks
+// and cross-checks; contexts already initialised keep theirs.
+int lzss_simd_limit(int max);
+
+// "scalar", "sse2", "ssse3" or "avx2"; NULL if out of range.
+const char *lzss_simd_name(int simd);
+
+size_t lzss_encoder_size(void);
+lzss_encoder *lzss_encoder_init(void *mem, int level); // NULL on a bad level
+lzss_encoder *lzss_encoder_create(int level);          // NULL on a bad level or OOM
+void lzss_encoder_destroy(lzss_encoder *e);            // only for lzss_encoder_create()
+
+// Starts a new stream with the previous history replaced by dict (at most
+// LZSS_HISTORY bytes; longer dictionaries keep their tail). Call right
+// after init or after LZSS_END.
+lzss_status lzss_encoder_prime(lzss_encoder *e, const void *dict, size_t len);
+
+// Pass finish = true once the last input has been handed over; keep
+// calling until LZSS_END, after which the context starts a new stream.
+lzss_status lzss_encoder_run(lzss_encoder *e, const void *in, size_t *in_len,
+                             void *out, size_t *out_len, bool finish);
+
+size_t lzss_decoder_size(void);
+lzss_decoder *lzss_decoder_init(void *mem);
+lzss_decoder *lzss_decoder_create(void); // NULL on OOM
+void lzss_decoder_destroy(lzss_decoder *d);
+lzss_status lzss_decoder_prime(lzss_decoder *d, const void *dict, size_t len);
+
+// Pass finish = true when no more input will follow. Returns LZSS_END once
+// the input has ended and all output has been delivered.
+lzss_status lzss_decoder_run(lzss_decoder *d, const void *in, size_t *in_len,
+                             void *out, size_t *out_len, bool finish);
+
+// Decompressed size of a stream, found by walking its tokens without
+// decoding them.
+uint64_t lzss_raw_size(const void *src, size_t len);
+
+// Largest index lzss_index_build() writes for a stream of raw_size bytes, or
+// 0 if interval is below LZSS_INDEX_INTERVAL_MIN.
+size_t lzss_index_bound(uint64_t raw_size, uint32_t interval);
+
+// Writes a checkpoint index for the stream src (zeroed history): one
+// checkpoint every interval output bytes, each holding the stream position
+// and the 4 KB of history there. Returns the index size or a negative
+// lzss_status. Works on any finished stream.
+int64_t lzss_index_build(const void *src, size_t len, uint32_t interval, void *dst, size_t cap);
+
+// Decodes n bytes from offset of the stream src into dst, starting from
+// the nearest checkpoint in front of offset, so the work is about interval +
+// n bytes wherever the range lies. Returns the bytes written (fewer than
+// n at the end of the stream, 0 past it) or a negative lzss_status;
+// LZSS_E_INDEX if index does not describe src.
+int64_t lzss_extract(const void *src, size_t len, const void *index, size_t index_len, uint64_t offset, void *dst,
+                     size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LZSS_H
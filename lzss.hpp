@@ -0,0 +1,753 @@
+// lzss.hpp — header-only C++23 LZSS codec with the stream format as a compile-time dialect
+//
+// Tokens per flag byte (LSB-first): 1 = literal (1 byte), 0 = pair (2 bytes).
+// Everything else is the dialect's: how the pair's 16 bits split between
+// offset and length, the history a stream starts from, and whether the offset
+// is a backward distance (7th Guest) or an absolute ring position, as in
+// Okumura's 1989 LZSS.C. Every dialect member is constexpr, so each
+// instantiation's loops are compiled for one format and never test it.
+//
+//   std::vector<std::uint8_t> packed = lzss::compress<lzss::SeventhGuest>(bytes);
+//   std::vector<std::uint8_t> raw = lzss::decompress<lzss::SeventhGuest>(packed);
+//
+// Encoder and Decoder keep their tables and output buffer between calls.
+
+#ifndef LZSS_HPP
+#define LZSS_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace lzss
+{
+
+enum class Fill
+{
+    zeros, // 7th Guest: the ring starts zeroed
+    spaces // 1989 LZSS.C: N - F spaces behind the first byte, zeros before them
+};
+
+enum class Source
+{
+    distance, // offset = distance - 1, in the high bits of a little-endian word
+    ring      // offset = ring slot of the match; low byte first, then the high bits above the length
+};
+
+enum class Level
+{
+    fast = 1,    // greedy, 16 hash-chain candidates per position
+    greedy = 2,  // greedy, exhaustive hash chains
+    lazy = 3,    // one-step lazy matching
+    optimal = 4  // fewest bits per 4 KB of input
+};
+
+struct Match
+{
+    std::size_t dist;
+    std::size_t len;
+};
+
+template <unsigned OffsetBits, unsigned LengthBits, Fill HistoryFill, Source PairSource>
+struct Dialect
+{
+    static_assert(OffsetBits + LengthBits == 16 && OffsetBits >= 8, "a pair is two bytes with at least 8 offset bits");
+
+    static constexpr std::size_t window = std::size_t{1} << OffsetBits; // N: ring size and largest distance
+    static constexpr unsigned length_mask = (1u << LengthBits) - 1u;
+    static constexpr std::size_t min_match = 3;                       // THRESHOLD + 1
+    static constexpr std::size_t max_match = min_match + length_mask; // F
+    static constexpr std::size_t ring_start = window - max_match;     // ring slot of the first byte
+
+    // Shortest and longest pair of the fast and greedy levels, and whether
+    // greedy runs the 1989 binary trees rather than hash chains. A dialect
+    // whose reference encoder parses differently overrides them.
+    static constexpr std::size_t greedy_min_match = min_match;
+    static constexpr std::size_t greedy_max_match = max_match;
+    static constexpr bool greedy_tree = false;
+
+    // Byte i of the window bytes in front of the first output byte, oldest
+    // first, as the reference decoder's ring holds them.
+    static constexpr std::uint8_t history(std::size_t i) noexcept
+    {
+        return HistoryFill == Fill::spaces && i >= max_match ? std::uint8_t{' '} : std::uint8_t{0};
+    }
+
+    // Pair bytes for match m starting at output position pos.
+    static constexpr std::array<std::uint8_t, 2> pack(std::size_t pos, Match m) noexcept
+    {
+        auto code = static_cast<unsigned>(m.len - min_match);
+        if constexpr (PairSource == Source::distance)
+        {
+            auto v = static_cast<unsigned>(m.dist - 1) << LengthBits | code;
+            return {static_cast<std::uint8_t>(v), static_cast<std::uint8_t>(v >> 8)};
+        }
+        else
+        {
+            auto slot = static_cast<unsigned>((ring_start + pos - m.dist) & (window - 1));
+            return {static_cast<std::uint8_t>(slot), static_cast<std::uint8_t>((slot >> 8) << LengthBits | code)};
+        }
+    }
+
+    // Match named by pair bytes b0 b1 at output position pos. A ring slot
+    // equal to the write slot is a full window back.
+    static constexpr Match unpack(std::size_t pos, std::uint8_t b0, std::uint8_t b1) noexcept
+    {
+        if constexpr (PairSource == Source::distance)
+        {
+            unsigned v = unsigned{b0} | unsigned{b1} << 8;
+            return {(v >> LengthBits) + std::size_t{1}, (v & length_mask) + min_match};
+        }
+        else
+        {
+            std::size_t slot = std::size_t{b0} | std::size_t{b1} >> LengthBits << 8;
+            std::size_t dist = (ring_start + pos - slot) & (window - 1);
+            return {dist ? dist : window, (b1 & length_mask) + min_match};
+        }
+    }
+};
+
+// The format of lzss_lib.c and the C CLI. Its fast and greedy levels emit
+// pairs of 4 to 16 bytes, as the 7th Guest encoder and the library do.
+struct SeventhGuest : Dialect<12, 4, Fill::zeros, Source::distance>
+{
+    static constexpr std::size_t greedy_min_match = min_match + 1;
+    static constexpr std::size_t greedy_max_match = length_mask + std::size_t{1};
+};
+// 7th Guest with a 2 KB window and matches of up to 34 bytes.
+using SeventhGuest11_5 = Dialect<11, 5, Fill::zeros, Source::distance>;
+// 1989/LZSS.C. Its greedy level is that program's Encode().
+struct Okumura : Dialect<12, 4, Fill::spaces, Source::ring>
+{
+    static constexpr bool greedy_tree = true;
+};
+
+// Worst-case compressed size of len bytes: every byte a literal.
+constexpr std::size_t bound(std::size_t len) noexcept
+{
+    return len + (len + 7) / 8;
+}
+
+namespace detail
+{
+
+inline constexpr unsigned hash_bits = 13;
+inline constexpr std::size_t opt_block = 4096;           // positions per optimal-parse window
+inline constexpr std::uint32_t literal_bits = 1 + 8;     // flag bit + byte
+inline constexpr std::uint32_t pair_bits = 1 + 16;       // flag bit + pair
+inline constexpr std::size_t group_in = 1 + 2 * 8;       // flag byte + 8 pairs
+
+inline std::uint32_t hash3(const std::uint8_t *p) noexcept
+{
+    std::uint32_t v = std::uint32_t{p[0]} << 16 | std::uint32_t{p[1]} << 8 | p[2];
+    return (v * 2654435761u) >> (32 - hash_bits);
+}
+
+inline std::size_t match_len(const std::uint8_t *a, const std::uint8_t *b, std::size_t max_len) noexcept
+{
+    std::size_t n = 0;
+    while (n < max_len && a[n] == b[n])
+        ++n;
+    return n;
+}
+
+// Flag groups into a buffer of at least bound() bytes.
+template <class D>
+class TokenWriter
+{
+public:
+    explicit TokenWriter(std::uint8_t *out = nullptr) noexcept : out_(out) {}
+
+    void literal(std::uint8_t c) noexcept
+    {
+        group();
+        out_[flag_at_] |= mask_;
+        out_[len_++] = c;
+        mask_ = static_cast<std::uint8_t>(mask_ << 1);
+    }
+
+    void pair(std::size_t pos, Match m) noexcept
+    {
+        group();
+        auto b = D::pack(pos, m);
+        out_[len_++] = b[0];
+        out_[len_++] = b[1];
+        mask_ = static_cast<std::uint8_t>(mask_ << 1);
+    }
+
+    std::size_t size() const noexcept { return len_; }
+
+private:
+    void group() noexcept
+    {
+        if (mask_ != 0)
+            return;
+        flag_at_ = len_;
+        out_[len_++] = 0;
+        mask_ = 1;
+    }
+
+    std::uint8_t *out_;
+    std::size_t len_ = 0;
+    std::size_t flag_at_ = 0;
+    std::uint8_t mask_ = 0;
+};
+
+// Bytes a match copy may write past its end: whole 16-byte chunks up to
+// max_match.
+template <class D>
+inline constexpr std::size_t copy_slack = (D::max_match + 15) / 16 * 16;
+
+// Copies a match of len bytes from dist behind d. Chunks are only used when
+// each source chunk lies entirely behind its destination chunk.
+template <class D>
+inline void copy_match(std::uint8_t *d, std::size_t dist, std::size_t len) noexcept
+{
+    const std::uint8_t *s = d - dist;
+    if (dist >= 16)
+    {
+        for (std::size_t i = 0; i < D::max_match; i += 16)
+            std::memcpy(d + i, s + i, 16);
+    }
+    else if (dist >= 8)
+    {
+        for (std::size_t i = 0; i < D::max_match; i += 8)
+            std::memcpy(d + i, s + i, 8);
+    }
+    else if (dist == 1)
+        std::memset(d, s[0], len);
+    else
+    {
+        for (std::size_t i = 0; i < len; ++i)
+            d[i] = s[i];
+    }
+}
+
+// Decodes whole flag groups while a worst-case group fits in the input and in
+// the output (with copy_slack), so the loop needs no bounds checks. out[-N, 0)
+// is the history, and out[0] is byte base of the stream: ring slots count
+// from there.
+template <class D>
+inline void decode_groups(const std::uint8_t *src, std::size_t slen, std::size_t &ip, std::uint8_t *out,
+                          std::size_t &op, std::size_t cap, std::size_t base) noexcept
+{
+    constexpr std::size_t group_out = 8 * D::max_match + copy_slack<D>;
+    while (slen - ip >= group_in && cap - op >= group_out)
+    {
+        unsigned flags = src[ip++];
+        if (flags == 0xFF)
+        {
+            std::memcpy(out + op, src + ip, 8);
+            ip += 8;
+            op += 8;
+            continue;
+        }
+        for (int i = 0; i < 8; ++i, flags >>= 1)
+        {
+            if (flags & 1)
+            {
+                out[op++] = src[ip++];
+                continue;
+            }
+            Match m = D::unpack(base + op, src[ip], src[ip + 1]);
+            ip += 2;
+            copy_match<D>(out + op, m.dist, m.len);
+            op += m.len;
+        }
+    }
+}
+
+// What decode_groups() leaves: token by token until the input ends. The caller
+// guarantees room for one more group. A token cut off by the end of the input
+// ends the stream, as in the reference decoders.
+template <class D>
+inline void decode_tail(const std::uint8_t *src, std::size_t slen, std::size_t &ip, std::uint8_t *out,
+                        std::size_t &op, std::size_t base) noexcept
+{
+    while (ip < slen)
+    {
+        unsigned flags = src[ip++];
+        for (int i = 0; i < 8 && ip < slen; ++i, flags >>= 1)
+        {
+            if (flags & 1)
+            {
+                out[op++] = src[ip++];
+                continue;
+            }
+            if (slen - ip < 2)
+                return;
+            Match m = D::unpack(base + op, src[ip], src[ip + 1]);
+            ip += 2;
+            const std::uint8_t *from = out + op - m.dist; // may start in the history
+            for (std::size_t j = 0; j < m.len; ++j)
+                out[op + j] = from[j];
+            op += m.len;
+        }
+    }
+}
+
+} // namespace detail
+
+// Hash-chain encoder. Matches only reach back into the stream itself, never
+// into the initial history, so the output decodes the same whatever the
+// history holds. With SeventhGuest it writes the same bytes as lzss_lib.c at
+// the same level. A greedy_tree dialect's greedy level is the 1989 encoder
+// instead, which also matches into the history.
+template <class D>
+class Encoder
+{
+public:
+    explicit Encoder(Level level = Level::greedy)
+        : level_(level), depth_(level == Level::fast ? std::size_t{16} : D::window),
+          min_pair_(level == Level::lazy || level == Level::optimal ? D::min_match : D::greedy_min_match),
+          max_pair_(level == Level::lazy || level == Level::optimal ? D::max_match : D::greedy_max_match),
+          head_(std::size_t{1} << detail::hash_bits), prev_(D::window)
+    {
+        if (D::greedy_tree && level == Level::greedy)
+        {
+            ring_.resize(D::window + D::max_match - 1);
+            lson_.resize(D::window + 1);
+            rson_.resize(D::window + 257);
+            dad_.resize(D::window + 1);
+        }
+        if (level == Level::optimal)
+        {
+            found_.resize(detail::opt_block);
+            cost_.resize(detail::opt_block + D::max_match);
+            step_.resize(detail::opt_block + D::max_match);
+            path_.resize(detail::opt_block + D::max_match);
+        }
+    }
+
+    // Compresses src as one stream. The view stays valid until the next call.
+    std::span<const std::uint8_t> encode(std::span<const std::uint8_t> src)
+    {
+        out_.resize(bound(src.size()));
+        src_ = src.data();
+        end_ = src.size();
+        tw_ = detail::TokenWriter<D>(out_.data());
+        if (D::greedy_tree && level_ == Level::greedy)
+        {
+            encode_tree();
+            return {out_.data(), tw_.size()};
+        }
+        std::ranges::fill(head_, -1);
+        for (std::size_t pos = 0; pos < end_;)
+        {
+            switch (level_)
+            {
+            case Level::lazy:
+                pos = parse_lazy(pos);
+                break;
+            case Level::optimal:
+                pos = parse_optimal(pos);
+                break;
+            default:
+                pos = parse_greedy(pos);
+                break;
+            }
+        }
+        return {out_.data(), tw_.size()};
+    }
+
+private:
+    std::size_t max_len(std::size_t pos) const noexcept
+    {
+        return std::min(end_ - pos, max_pair_);
+    }
+
+    // Longest match at pos; candidates are walked nearest-first and only a
+    // strictly longer one replaces the current best.
+    Match find(std::size_t pos, std::size_t max_len) const noexcept
+    {
+        Match m{0, 0};
+        if (max_len < D::min_match)
+            return m;
+        const std::uint8_t *cur = src_ + pos;
+        std::size_t reach = std::min(pos, D::window);
+        std::size_t depth = depth_;
+        for (std::int64_t cand = head_[detail::hash3(cur)];
+             cand >= 0 && pos - static_cast<std::size_t>(cand) <= reach && depth-- > 0;
+             cand = prev_[static_cast<std::size_t>(cand) & (D::window - 1)])
+        {
+            std::size_t dist = pos - static_cast<std::size_t>(cand);
+            const std::uint8_t *s = cur - dist;
+            if (s[m.len] != cur[m.len])
+                continue;
+            std::size_t len = detail::match_len(s, cur, max_len);
+            if (len > m.len)
+            {
+                m = {dist, len};
+                if (len == max_len)
+                    break;
+            }
+        }
+        return m;
+    }
+
+    // Registers count positions from pos that still have a full 3-byte key.
+    void insert(std::size_t pos, std::size_t count) noexcept
+    {
+        std::size_t keyed = end_ - pos > 2 ? end_ - pos - 2 : 0;
+        for (std::size_t i = 0; i < count && i < keyed; ++i)
+        {
+            std::uint32_t h = detail::hash3(src_ + pos + i);
+            prev_[(pos + i) & (D::window - 1)] = head_[h];
+            head_[h] = static_cast<std::int64_t>(pos + i);
+        }
+    }
+
+    // Emits one token at pos and returns the number of bytes it covers.
+    std::size_t emit(std::size_t pos, Match m) noexcept
+    {
+        if (m.len >= min_pair_)
+        {
+            tw_.pair(pos, m);
+            return m.len;
+        }
+        tw_.literal(src_[pos]);
+        return 1;
+    }
+
+    std::size_t parse_greedy(std::size_t pos) noexcept
+    {
+        std::size_t step = emit(pos, find(pos, max_len(pos)));
+        insert(pos, step);
+        return pos + step;
+    }
+
+    // If the match at pos + 1 is at least two bytes longer, pos goes out as a
+    // literal and the search moves on.
+    std::size_t parse_lazy(std::size_t pos) noexcept
+    {
+        Match m = find(pos, max_len(pos));
+        insert(pos, 1);
+        while (m.len >= min_pair_ && m.len < max_pair_ && pos + 1 < end_)
+        {
+            Match next = find(pos + 1, max_len(pos + 1));
+            if (next.len <= m.len + 1)
+                break;
+            tw_.literal(src_[pos]);
+            ++pos;
+            insert(pos, 1);
+            m = next;
+        }
+        std::size_t step = emit(pos, m);
+        insert(pos + 1, step - 1);
+        return pos + step;
+    }
+
+    // Cheapest token sequence over the next opt_block positions; a pair costs
+    // the same at every distance and length, so the longest match per
+    // position is all the search needs. The parse may stop up to
+    // max_match - 1 bytes past the window, where bytes are credited at about
+    // one bit each.
+    std::size_t parse_optimal(std::size_t pos) noexcept
+    {
+        std::size_t n = std::min(end_ - pos, detail::opt_block);
+        std::size_t reach = n;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            found_[i] = find(pos + i, max_len(pos + i));
+            insert(pos + i, 1);
+            reach = std::max(reach, i + found_[i].len);
+        }
+
+        cost_[0] = 0;
+        std::fill(cost_.begin() + 1, cost_.begin() + static_cast<std::ptrdiff_t>(reach) + 1,
+                  std::numeric_limits<std::uint32_t>::max());
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            std::uint32_t c = cost_[i];
+            if (c + detail::literal_bits < cost_[i + 1])
+            {
+                cost_[i + 1] = c + detail::literal_bits;
+                step_[i + 1] = 1;
+            }
+            for (std::size_t len = D::min_match; len <= found_[i].len; ++len)
+            {
+                if (c + detail::pair_bits < cost_[i + len])
+                {
+                    cost_[i + len] = c + detail::pair_bits;
+                    step_[i + len] = static_cast<std::uint8_t>(len);
+                }
+            }
+        }
+
+        std::size_t stop = n;
+        for (std::size_t j = n + 1; j <= reach; ++j)
+        {
+            if (cost_[j] != std::numeric_limits<std::uint32_t>::max() &&
+                cost_[j] - static_cast<std::uint32_t>(j - n) < cost_[stop] - static_cast<std::uint32_t>(stop - n))
+                stop = j;
+        }
+
+        std::size_t tokens = 0;
+        for (std::size_t j = stop; j > 0; j -= step_[j])
+            path_[tokens++] = step_[j];
+        for (std::size_t i = 0; tokens > 0;)
+        {
+            std::size_t len = path_[--tokens];
+            if (len == 1)
+                tw_.literal(src_[pos + i]);
+            else
+                tw_.pair(pos + i, {found_[i].dist, len});
+            i += len;
+        }
+        insert(pos + n, stop - n);
+        return pos + stop;
+    }
+
+    // 1989 LZSS.C's Encode(), ported line for line: one binary search tree per
+    // first byte over a ring that starts with the history, whose last F
+    // strings go in before the first byte's. A tie goes to the first node met
+    // on the way down rather than the nearest, so no hash-chain parse writes
+    // its bytes. The ring starts zeroed, as in a fresh run of the program.
+    void encode_tree() noexcept
+    {
+        constexpr std::size_t n = D::window, f = D::max_match, nil = D::window;
+        std::ranges::fill(ring_, std::uint8_t{0});
+        for (std::size_t i = 0; i < n - f; ++i)
+            ring_[i] = D::history(f + i);
+        std::fill(rson_.begin() + n + 1, rson_.end(), nil);
+        std::fill(dad_.begin(), dad_.begin() + n, nil);
+
+        std::size_t s = 0, r = D::ring_start, in = 0, len = 0;
+        for (; len < f && in < end_; ++len)
+            ring_[r + len] = src_[in++];
+        if (len == 0)
+            return;
+        for (std::size_t i = 1; i <= f; ++i)
+            tree_insert(r - i);
+        tree_insert(r);
+        for (std::size_t pos = 0; len > 0;)
+        {
+            std::size_t step = std::min(tree_len_, len);
+            if (step < D::min_match)
+            {
+                step = 1;
+                tw_.literal(ring_[r]);
+            }
+            else
+                tw_.pair(pos, {(r - tree_at_) & (n - 1), step});
+            pos += step;
+            // Each byte covered slides the window: the oldest string leaves,
+            // the next input byte comes in and the string at r goes in. Past
+            // the end of the input the lookahead shrinks instead.
+            for (std::size_t i = 0; i < step; ++i)
+            {
+                tree_delete(s);
+                bool fed = in < end_;
+                if (fed)
+                {
+                    ring_[s] = src_[in++];
+                    if (s < f - 1)
+                        ring_[s + n] = ring_[s];
+                }
+                s = (s + 1) & (n - 1);
+                r = (r + 1) & (n - 1);
+                if (fed || --len)
+                    tree_insert(r);
+            }
+        }
+    }
+
+    // InsertNode(): adds the string at ring slot r, setting tree_len_ and
+    // tree_at_ to its longest match. A node matching all F bytes is replaced
+    // by r, which leaves the window later.
+    void tree_insert(std::size_t r) noexcept
+    {
+        constexpr std::size_t n = D::window, f = D::max_match, nil = D::window;
+        const std::uint8_t *key = &ring_[r];
+        std::size_t p = n + 1 + key[0];
+        int cmp = 1;
+        rson_[r] = lson_[r] = nil;
+        tree_len_ = 0;
+        for (;;)
+        {
+            std::size_t &child = cmp >= 0 ? rson_[p] : lson_[p];
+            if (child == nil)
+            {
+                child = r;
+                dad_[r] = p;
+                return;
+            }
+            p = child;
+            std::size_t i = 1;
+            for (; i < f; ++i)
+                if ((cmp = key[i] - ring_[p + i]) != 0)
+                    break;
+            if (i > tree_len_)
+            {
+                tree_at_ = p;
+                if ((tree_len_ = i) >= f)
+                    break;
+            }
+        }
+        dad_[r] = dad_[p];
+        lson_[r] = lson_[p];
+        rson_[r] = rson_[p];
+        dad_[lson_[p]] = r;
+        dad_[rson_[p]] = r;
+        (rson_[dad_[p]] == p ? rson_[dad_[p]] : lson_[dad_[p]]) = r;
+        dad_[p] = nil;
+    }
+
+    // DeleteNode(): removes the string at ring slot p, if it is in a tree.
+    void tree_delete(std::size_t p) noexcept
+    {
+        constexpr std::size_t nil = D::window;
+        if (dad_[p] == nil)
+            return;
+        std::size_t q;
+        if (rson_[p] == nil)
+            q = lson_[p];
+        else if (lson_[p] == nil)
+            q = rson_[p];
+        else
+        {
+            q = lson_[p];
+            if (rson_[q] != nil)
+            {
+                do
+                    q = rson_[q];
+                while (rson_[q] != nil);
+                rson_[dad_[q]] = lson_[q];
+                dad_[lson_[q]] = dad_[q];
+                lson_[q] = lson_[p];
+                dad_[lson_[p]] = q;
+            }
+            rson_[q] = rson_[p];
+            dad_[rson_[p]] = q;
+        }
+        dad_[q] = dad_[p];
+        (rson_[dad_[p]] == p ? rson_[dad_[p]] : lson_[dad_[p]]) = q;
+        dad_[p] = nil;
+    }
+
+    Level level_;
+    std::size_t depth_;    // hash-chain candidates examined per position
+    std::size_t min_pair_; // shortest pair emitted
+    std::size_t max_pair_; // longest pair emitted; the dialect may cap it at the greedy levels
+    const std::uint8_t *src_ = nullptr;
+    std::size_t end_ = 0;
+    detail::TokenWriter<D> tw_;
+    std::vector<std::int64_t> head_; // newest position per hash, -1 if none
+    std::vector<std::int64_t> prev_; // next older position with the same hash, per ring slot
+    std::vector<std::uint8_t> out_;
+    // Optimal-parse scratch for one opt_block window
+    std::vector<Match> found_;        // longest match at each position
+    std::vector<std::uint32_t> cost_; // cheapest bits to reach each position
+    std::vector<std::uint8_t> step_;  // token length that reached it (1 = literal)
+    std::vector<std::uint8_t> path_;  // token lengths, back to front
+    // 1989 trees, for a greedy_tree dialect at Level::greedy. Slot N is NIL;
+    // rson_[N + 1 + c] is the root of the tree of strings starting with c.
+    std::vector<std::uint8_t> ring_;  // N slots, then the first F - 1 again
+    std::vector<std::size_t> lson_, rson_, dad_;
+    std::size_t tree_len_ = 0, tree_at_ = 0; // longest match of the last insert
+};
+
+// Decoder into a linear buffer with the dialect's history in front of the
+// output, so every distance up to N lands inside the buffer. Every byte string
+// is a valid stream.
+template <class D>
+class Decoder
+{
+public:
+    // Decodes src as one stream. The view stays valid until the next call.
+    std::span<const std::uint8_t> decode(std::span<const std::uint8_t> src)
+    {
+        restart(std::max<std::size_t>(src.size() * 4, std::size_t{1} << 16));
+        std::size_t ip = 0, op = 0;
+        for (;;)
+        {
+            detail::decode_groups<D>(src.data(), src.size(), ip, out(), op, cap_, 0);
+            if (src.size() - ip < detail::group_in && cap_ - op >= room)
+                break; // less than a worst-case group of input left, and room for it
+            reserve(cap_ * 2, op);
+        }
+        detail::decode_tail<D>(src.data(), src.size(), ip, out(), op, 0);
+        return {out(), op};
+    }
+
+    // Decodes src as one stream and hands the output to sink(span) in pieces
+    // of at most chunk bytes, so memory stays at N + chunk whatever the
+    // output size. The last N bytes of each piece become the history of the
+    // next. Returns the output size.
+    template <class Sink>
+    std::uint64_t decode(std::span<const std::uint8_t> src, Sink &&sink, std::size_t chunk = std::size_t{1} << 20)
+    {
+        chunk = std::max(chunk, D::window + room);
+        restart(chunk);
+        std::size_t ip = 0;
+        std::uint64_t base = 0;
+        for (;;)
+        {
+            std::size_t op = 0;
+            detail::decode_groups<D>(src.data(), src.size(), ip, out(), op, chunk, static_cast<std::size_t>(base));
+            bool last = src.size() - ip < detail::group_in && chunk - op >= room;
+            if (last)
+                detail::decode_tail<D>(src.data(), src.size(), ip, out(), op, static_cast<std::size_t>(base));
+            sink(std::span<const std::uint8_t>(out(), op));
+            base += op;
+            if (last)
+                return base;
+            std::memmove(buf_.get(), out() + op - D::window, D::window);
+        }
+    }
+
+private:
+    static constexpr std::size_t room = 8 * D::max_match + detail::copy_slack<D>; // one worst-case group
+
+    std::uint8_t *out() noexcept { return buf_.get() + D::window; }
+
+    // Starts a stream: room for cap output bytes behind the initial history.
+    void restart(std::size_t cap)
+    {
+        reserve(cap, 0);
+        for (std::size_t i = 0; i < D::window; ++i)
+            buf_[i] = D::history(i);
+    }
+
+    // Makes room for cap output bytes, keeping the history and the first keep.
+    void reserve(std::size_t cap, std::size_t keep)
+    {
+        if (cap <= cap_)
+            return;
+        auto grown = std::make_unique_for_overwrite<std::uint8_t[]>(D::window + cap + detail::copy_slack<D>);
+        if (buf_)
+            std::memcpy(grown.get(), buf_.get(), D::window + keep);
+        buf_ = std::move(grown);
+        cap_ = cap;
+    }
+
+    std::unique_ptr<std::uint8_t[]> buf_;
+    std::size_t cap_ = 0;
+};
+
+template <class D>
+std::vector<std::uint8_t> compress(std::span<const std::uint8_t> src, Level level = Level::greedy)
+{
+    Encoder<D> e(level);
+    auto out = e.encode(src);
+    return {out.begin(), out.end()};
+}
+
+template <class D>
+std::vector<std::uint8_t> decompress(std::span<const std::uint8_t> src)
+{
+    Decoder<D> d;
+    auto out = d.decode(src);
+    return {out.begin(), out.end()};
+}
+
+} // namespace lzss
+
+#endif // LZSS_HPP
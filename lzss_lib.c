@@ -0,0 +1,1555 @@
+// lzss_lib.c — 7th-Guest–style LZSS codec library (see lzss.h for the API)
+// Tokens per flag byte (LSB-first): 1 = literal (1 byte), 0 = pair (2 bytes).
+// Pair layout: ofs_len = ((distance - 1) << 4) | (length - 3), where distance
+// is the backward match distance in bytes (1..4096). Fixed spec: LENGTH_BITS=4
+// → N=4096, F=16, THR=3. History start at N-F.
+//
+// Nothing here touches files, prints, or exits; the CLI lives in lzss.c.
+
+#include "lzss.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// ASM build mode: x86-64 SIMD kernels, picked at run time (see "Kernel
+// dispatch"). Every other build has the scalar kernels only.
+#if defined(ASM_MODE) && (defined(__x86_64__) || defined(_M_X64))
+#define LZSS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#else
+#define LZSS_X86 0
+#endif
+
+// Compiles one function for an instruction set beyond the x86-64 baseline.
+// flatten inlines everything it calls, so shared baseline code (and inline
+// kernels of the same set) are compiled for that set too.
+#if LZSS_X86 && (!defined(_MSC_VER) || defined(__clang__))
+#define TARGET(isa) __attribute__((target(isa), flatten))
+#else
+#define TARGET(isa)
+#endif
+
+enum
+{
+    LENGTH_BITS = 4,
+    LENGTH_MASK = (1u << LENGTH_BITS) - 1u, // 0x0F
+    N = 1 << (16 - LENGTH_BITS),            // 4096
+    F = 1 << LENGTH_BITS,                   // 16
+    THR = 3,                                // actual_len = stored + THR
+    N_MASK = N - 1
+};
+
+// Encoder working set. The encoder keeps its input in a linear window so that
+// history and look-ahead never alias: [pos - N, pos) is history, [pos, end) is
+// look-ahead. The decoder's ring is untouched by this; it only ever sees
+// (distance, length) pairs with distance <= N.
+enum
+{
+    MIN_MATCH = THR + 1,     // shortest pair the greedy encoder emits (4)
+    GREEDY_MAX = F,          // longest pair the reference greedy encoder emits (16)
+    MAX_MATCH = F + THR - 1, // longest pair the format holds (18)
+    HASH_BITS = 13,
+    HASH_SIZE = 1 << HASH_BITS,
+    WIN_CHUNK = 1 << 16,     // input taken per window slide
+    WIN_CAP = N + WIN_CHUNK, // history + one chunk
+    OUT_CAP = 1 << 16,       // pending output of a streaming encoder
+    OPT_BLOCK = 4096,        // positions per optimal-parse window
+    LITERAL_BITS = 1 + 8,    // flag bit + byte
+    PAIR_BITS = 1 + 16       // flag bit + ofs_len word
+};
+
+typedef enum
+{
+    FINDER_SCAN,  // brute-force reference: every distance, every byte
+    FINDER_CHAIN  // hash chains on 3-byte prefixes, exhaustive within N
+} MatchFinder;
+
+typedef enum
+{
+    PARSE_GREEDY, // longest match at pos, else literal
+    PARSE_LAZY,   // defer a match by one byte if the next one is longer
+    PARSE_OPTIMAL // cheapest bit cost over each OPT_BLOCK window
+} Parse;
+
+typedef struct
+{
+    const char *name;
+    Parse parse;
+    MatchFinder finder;
+    int depth;     // hash-chain candidates examined per position
+    int min_match; // shortest pair emitted
+    int max_match; // longest pair emitted
+} Level;
+
+// Indexed by LZSS_LEVEL_*. SCAN and GREEDY are the reference greedy stream:
+// the old encoder's look-ahead held F bytes, so its pairs stop at 16 and the
+// greedy levels keep that cap. Every level decodes with the same decoder.
+static const Level LEVELS[] = {
+    {"scan", PARSE_GREEDY, FINDER_SCAN, N, MIN_MATCH, GREEDY_MAX},
+    {"fast", PARSE_GREEDY, FINDER_CHAIN, 16, MIN_MATCH, GREEDY_MAX},
+    {"greedy", PARSE_GREEDY, FINDER_CHAIN, N, MIN_MATCH, GREEDY_MAX},
+    {"lazy", PARSE_LAZY, FINDER_CHAIN, N, THR, MAX_MATCH},
+    {"optimal", PARSE_OPTIMAL, FINDER_CHAIN, N, THR, MAX_MATCH},
+};
+enum
+{
+    LEVEL_COUNT = (int)(sizeof(LEVELS) / sizeof(LEVELS[0])),
+    // Most output one parse step can add: an optimal window of literals.
+    STEP_MAX_OUT = (OPT_BLOCK + MAX_MATCH) + (OPT_BLOCK + MAX_MATCH + 7) / 8 + 1
+};
+
+typedef struct
+{
+    int dist;
+    int len;
+} Match;
+
+// Either collects streamed input in `store`, or (eof from the start) views a
+// caller's buffer that already holds everything.
+typedef struct
+{
+    uint8_t *store;
+    const uint8_t *buf;
+    uint64_t base; // stream offset of buf[0]
+    uint64_t end;  // stream offset one past the last byte read
+    bool eof;
+} Window;
+
+// Hash chains keyed on absolute stream positions. prev[] is indexed by
+// pos & N_MASK: an entry is only followed while pos - cand <= N, and the slot
+// for cand is not reused until cand + N is inserted, which is never before the
+// search at pos - so the chain seen from pos is always intact.
+typedef struct
+{
+    int64_t head[HASH_SIZE];
+    int64_t prev[N];
+} HashChains;
+
+// Appends tokens to buf: the streaming encoder's pending output, or a caller
+// buffer of at least lzss_bound() bytes. The caller keeps room for the step.
+typedef struct
+{
+    uint8_t *buf;
+    size_t len;     // bytes in buf
+    size_t flag_at; // index of the open group's flag byte
+    uint8_t mask;   // next flag bit; 0 = no open group
+} TokenWriter;
+
+static inline const uint8_t *window_at(const Window *w, uint64_t pos)
+{
+    return w->buf + (size_t)(pos - w->base);
+}
+
+// Appends up to len bytes of input and returns how many were taken. A full
+// window first drops everything but the N bytes of history in front of pos.
+static size_t window_push(Window *w, uint64_t pos, const uint8_t *in, size_t len)
+{
+    size_t live = (size_t)(w->end - w->base);
+    if (live == WIN_CAP)
+    {
+        uint64_t keep = pos > N ? pos - N : 0;
+        live = (size_t)(w->end - keep);
+        memmove(w->store, w->buf + (size_t)(keep - w->base), live);
+        w->base = keep;
+    }
+    size_t take = len < WIN_CAP - live ? len : WIN_CAP - live;
+    memcpy(w->store + live, in, take);
+    w->end += take;
+    return take;
+}
+
+static inline int match_len(const uint8_t *a, const uint8_t *b, int max_len)
+{
+    int L = 0;
+    while (L < max_len && a[L] == b[L])
+        ++L;
+    return L;
+}
+
+#if LZSS_X86
+static inline int bit_low(uint32_t v)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanForward(&i, v);
+    return (int)i;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+static inline int bit_high(uint32_t v)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long i;
+    _BitScanReverse(&i, v);
+    return (int)i;
+#else
+    return 31 - __builtin_clz(v);
+#endif
+}
+
+// match_len() on 16 bytes at a time: one compare, one movemask, one ctz.
+// Only used when max_len >= 16, so neither load reads past the look-ahead.
+static inline int match_len_sse2(const uint8_t *a, const uint8_t *b, int max_len)
+{
+    if (max_len < 16)
+        return match_len(a, b, max_len);
+    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)a), _mm_loadu_si128((const __m128i *)b));
+    uint32_t diff = (uint32_t)_mm_movemask_epi8(eq) ^ 0xFFFFu;
+    if (diff)
+        return bit_low(diff);
+    return 16 + match_len(a + 16, b + 16, max_len - 16);
+}
+#else
+#define match_len_sse2 match_len
+#endif
+
+// Brute-force reference: scan distances 1..hsz and keep the first (nearest)
+// of the longest matches. Slow, but the definition of greedy-compatible output.
+static Match find_match_scan(const uint8_t *cur, int hsz, int max_len)
+{
+    Match m = {0, 0};
+    for (int dist = 1; dist <= hsz; ++dist)
+    {
+        int L = match_len(cur - dist, cur, max_len);
+        if (L > m.len)
+        {
+            m.len = L;
+            m.dist = dist;
+            if (L == max_len)
+                break;
+        }
+    }
+    return m;
+}
+
+#if LZSS_X86
+// Scan kernels test a block of distances at once: a candidate must match the
+// first two bytes of cur. Bit k of hits stands for distance top - k, so the
+// highest bit is the nearest candidate and is tried first. Returns true once
+// the match reaches max_len.
+static inline bool scan_hits(const uint8_t *cur, int top, uint32_t hits, int max_len, Match *m)
+{
+    while (hits)
+    {
+        int k = bit_high(hits);
+        hits ^= 1u << k;
+        int L = match_len_sse2(cur - (top - k), cur, max_len);
+        if (L > m->len)
+        {
+            m->len = L;
+            m->dist = top - k;
+            if (L == max_len)
+                return true;
+        }
+    }
+    return false;
+}
+
+// Rest of a scan, one distance at a time, from dist up to hsz.
+static inline Match scan_tail(const uint8_t *cur, int dist, int hsz, int max_len, Match m)
+{
+    for (; dist <= hsz && m.len < max_len; ++dist)
+    {
+        int L = match_len_sse2(cur - dist, cur, max_len);
+        if (L > m.len)
+        {
+            m.len = L;
+            m.dist = dist;
+        }
+    }
+    return m;
+}
+
+// find_match_scan() 16 distances per step. Same result for every match of two
+// bytes or more, which covers every match a parser can emit.
+static Match find_match_scan_sse2(const uint8_t *cur, int hsz, int max_len)
+{
+    Match m = {0, 0};
+    if (max_len < 2)
+        return find_match_scan(cur, hsz, max_len);
+    const __m128i c0 = _mm_set1_epi8((char)cur[0]);
+    const __m128i c1 = _mm_set1_epi8((char)cur[1]);
+    int dist = 1;
+    for (; dist + 15 <= hsz; dist += 16)
+    {
+        const uint8_t *p = cur - (dist + 15);
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), c0);
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 1)), c1);
+        uint32_t hits = (uint32_t)_mm_movemask_epi8(_mm_and_si128(a, b));
+        if (hits && scan_hits(cur, dist + 15, hits, max_len, &m))
+            return m;
+    }
+    return scan_tail(cur, dist, hsz, max_len, m);
+}
+
+// As find_match_scan_sse2(), 32 distances per step.
+TARGET("avx2") static Match find_match_scan_avx2(const uint8_t *cur, int hsz, int max_len)
+{
+    Match m = {0, 0};
+    if (max_len < 2)
+        return find_match_scan(cur, hsz, max_len);
+    const __m256i c0 = _mm256_set1_epi8((char)cur[0]);
+    const __m256i c1 = _mm256_set1_epi8((char)cur[1]);
+    int dist = 1;
+    for (; dist + 31 <= hsz; dist += 32)
+    {
+        const uint8_t *p = cur - (dist + 31);
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p), c0);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(p + 1)), c1);
+        uint32_t hits = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(a, b));
+        if (hits && scan_hits(cur, dist + 31, hits, max_len, &m))
+            return m;
+    }
+    return scan_tail(cur, dist, hsz, max_len, m);
+}
+#endif
+
+static inline uint32_t hash3(const uint8_t *p)
+{
+    uint32_t v = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void chains_init(HashChains *hc)
+{
+    for (int i = 0; i < HASH_SIZE; ++i)
+        hc->head[i] = -1;
+}
+
+static inline void chains_insert(HashChains *hc, const uint8_t *cur, int64_t pos)
+{
+    uint32_t h = hash3(cur);
+    hc->prev[pos & N_MASK] = hc->head[h];
+    hc->head[h] = pos;
+}
+
+// Walks candidates nearest-first and keeps only strictly longer matches, so
+// with depth >= N the result equals find_match_scan() for every match of
+// MIN_MATCH or more. wide picks the SIMD length compare.
+static inline Match chain_walk(const HashChains *hc, const uint8_t *cur, int64_t pos, int hsz, int max_len, int depth,
+                               bool wide)
+{
+    Match m = {0, 0};
+    if (max_len < 3)
+        return m;
+    int64_t cand = hc->head[hash3(cur)];
+    while (cand >= 0 && pos - cand <= hsz && depth-- > 0)
+    {
+        int dist = (int)(pos - cand);
+        const uint8_t *src = cur - dist;
+        if (src[m.len] == cur[m.len])
+        {
+            int L = wide ? match_len_sse2(src, cur, max_len) : match_len(src, cur, max_len);
+            if (L > m.len)
+            {
+                m.len = L;
+                m.dist = dist;
+                if (L == max_len)
+                    break;
+            }
+        }
+        cand = hc->prev[cand & N_MASK];
+    }
+    return m;
+}
+
+static Match find_match_chain(const HashChains *hc, const uint8_t *cur, int64_t pos, int hsz, int max_len, int depth)
+{
+    return chain_walk(hc, cur, pos, hsz, max_len, depth, false);
+}
+
+#if LZSS_X86
+static Match find_match_chain_sse2(const HashChains *hc, const uint8_t *cur, int64_t pos, int hsz, int max_len,
+                                   int depth)
+{
+    return chain_walk(hc, cur, pos, hsz, max_len, depth, true);
+}
+#endif
+
+// Opens a new flag group when needed.
+static inline void writer_group(TokenWriter *tw)
+{
+    if (tw->mask != 0)
+        return;
+    tw->flag_at = tw->len;
+    tw->buf[tw->len++] = 0;
+    tw->mask = 1;
+}
+
+static inline void writer_literal(TokenWriter *tw, uint8_t c)
+{
+    writer_group(tw);
+    tw->buf[tw->flag_at] |= tw->mask;
+    tw->buf[tw->len++] = c;
+    tw->mask <<= 1;
+}
+
+static inline void writer_pair(TokenWriter *tw, int dist, int len)
+{
+    writer_group(tw);
+    uint32_t dist_field = (uint32_t)(dist - 1); // store as 0..4095
+    uint16_t ofs_len = (uint16_t)(((dist_field & N_MASK) << LENGTH_BITS) | (uint32_t)((len - THR) & LENGTH_MASK));
+    tw->buf[tw->len++] = (uint8_t)(ofs_len & 0xFF);
+    tw->buf[tw->len++] = (uint8_t)(ofs_len >> 8);
+    tw->mask <<= 1;
+}
+
+// The hot loops, in the variant the CPU runs best; see "Kernel dispatch".
+typedef struct
+{
+    Match (*scan)(const uint8_t *cur, int hsz, int max_len);
+    Match (*chain)(const HashChains *hc, const uint8_t *cur, int64_t pos, int hsz, int max_len, int depth);
+    void (*decode)(const uint8_t *src, size_t slen, size_t *ipp, uint8_t *dst, size_t *opp, size_t limit);
+} Kernels;
+
+struct lzss_encoder
+{
+    Window w;
+    HashChains hc;
+    TokenWriter tw;
+    Level level;
+    const Kernels *k;
+    uint64_t pos;             // streaming: next position to parse
+    uint64_t unhashed;        // streaming: primed positions not yet in the chains
+    size_t drained;           // streaming: pending bytes already handed out
+    uint8_t window[WIN_CAP];  // streaming input
+    uint8_t pending[OUT_CAP]; // streaming output
+    // Optimal-parse scratch for one OPT_BLOCK window
+    Match found[OPT_BLOCK];       // longest match starting at each position
+    uint32_t cost[OPT_BLOCK + MAX_MATCH]; // cheapest bits to reach each position
+    uint8_t step[OPT_BLOCK + MAX_MATCH];  // token length that reached it (1 = literal)
+    uint8_t path[OPT_BLOCK + MAX_MATCH];  // token lengths, back to front
+};
+typedef struct lzss_encoder Encoder;
+
+// Longest history match at pos, capped at max_len. Only positions before pos
+// are referenced, so the virtual zeroed prefix is never used.
+static inline Match encoder_find(const Encoder *e, uint64_t pos, int max_len)
+{
+    const uint8_t *cur = window_at(&e->w, pos);
+    int hsz = (int)(pos < N ? pos : N);
+    if (e->level.finder == FINDER_SCAN)
+        return e->k->scan(cur, hsz, max_len);
+    return e->k->chain(&e->hc, cur, (int64_t)pos, hsz, max_len, e->level.depth);
+}
+
+// Register count positions from pos that still have a full 3-byte key.
+static inline void encoder_insert(Encoder *e, uint64_t pos, int count)
+{
+    if (e->level.finder != FINDER_CHAIN)
+        return;
+    uint64_t left = e->w.end - pos;
+    uint64_t keyed = left > 2 ? left - 2 : 0;
+    const uint8_t *cur = window_at(&e->w, pos);
+    for (int i = 0; i < count && (uint64_t)i < keyed; ++i)
+        chains_insert(&e->hc, cur + i, (int64_t)(pos + (uint64_t)i));
+}
+
+static inline int encoder_max_len(const Encoder *e, uint64_t pos)
+{
+    uint64_t left = e->w.end - pos;
+    return left < (uint64_t)e->level.max_match ? (int)left : e->level.max_match;
+}
+
+// Emits one token at pos and returns the number of bytes it covers.
+static inline int encoder_emit(Encoder *e, uint64_t pos, Match m)
+{
+    if (m.len >= e->level.min_match)
+    {
+        writer_pair(&e->tw, m.dist, m.len);
+        return m.len;
+    }
+    writer_literal(&e->tw, *window_at(&e->w, pos));
+    return 1;
+}
+
+// Greedy: take the longest match at pos if it beats the literal threshold.
+static uint64_t parse_greedy(Encoder *e, uint64_t pos)
+{
+    Match m = encoder_find(e, pos, encoder_max_len(e, pos));
+    int step = encoder_emit(e, pos, m);
+    encoder_insert(e, pos, step);
+    return pos + (uint64_t)step;
+}
+
+// One-step lazy: if the match at pos + 1 is at least two bytes longer than the
+// one at pos, emit pos as a literal and retry from pos + 1 (its search is
+// reused). One extra byte does not pay for the 9-bit literal.
+static uint64_t parse_lazy(Encoder *e, uint64_t pos)
+{
+    Match m = encoder_find(e, pos, encoder_max_len(e, pos));
+    encoder_insert(e, pos, 1);
+    while (m.len >= e->level.min_match && m.len < e->level.max_match && pos + 1 < e->w.end)
+    {
+        Match next = encoder_find(e, pos + 1, encoder_max_len(e, pos + 1));
+        if (next.len <= m.len + 1)
+            break;
+        writer_literal(&e->tw, *window_at(&e->w, pos));
+        ++pos;
+        encoder_insert(e, pos, 1);
+        m = next;
+    }
+    int step = encoder_emit(e, pos, m);
+    encoder_insert(e, pos + 1, step - 1);
+    return pos + (uint64_t)step;
+}
+
+// Optimal: find the longest match at every position of the next window, then
+// pick the token sequence with the fewest output bits. A pair costs the same
+// for every distance and length, and a match of length L at distance d is also
+// a match of every shorter length at d, so the longest match per position is
+// all the search needs. The last pair may run up to MAX_MATCH - 1 bytes past
+// the window; those bytes are credited at about one bit each (a full pair's
+// rate) when choosing where the window's parse stops.
+static uint64_t parse_optimal(Encoder *e, uint64_t pos)
+{
+    uint64_t left = e->w.end - pos;
+    int n = left < OPT_BLOCK ? (int)left : OPT_BLOCK;
+    int reach = n;
+
+    for (int i = 0; i < n; ++i)
+    {
+        e->found[i] = encoder_find(e, pos + (uint64_t)i, encoder_max_len(e, pos + (uint64_t)i));
+        encoder_insert(e, pos + (uint64_t)i, 1);
+        if (i + e->found[i].len > reach)
+            reach = i + e->found[i].len;
+    }
+
+    e->cost[0] = 0;
+    for (int i = 1; i <= reach; ++i)
+        e->cost[i] = UINT32_MAX;
+    for (int i = 0; i < n; ++i)
+    {
+        uint32_t c = e->cost[i];
+        if (c + LITERAL_BITS < e->cost[i + 1])
+        {
+            e->cost[i + 1] = c + LITERAL_BITS;
+            e->step[i + 1] = 1;
+        }
+        for (int L = e->level.min_match; L <= e->found[i].len; ++L)
+        {
+            if (c + PAIR_BITS < e->cost[i + L])
+            {
+                e->cost[i + L] = c + PAIR_BITS;
+                e->step[i + L] = (uint8_t)L;
+            }
+        }
+    }
+
+    int stop = n;
+    for (int j = n + 1; j <= reach; ++j)
+    {
+        if (e->cost[j] != UINT32_MAX && e->cost[j] - (uint32_t)(j - n) < e->cost[stop] - (uint32_t)(stop - n))
+            stop = j;
+    }
+
+    int tokens = 0;
+    for (int j = stop; j > 0; j -= e->step[j])
+        e->path[tokens++] = e->step[j];
+    int i = 0;
+    while (tokens > 0)
+    {
+        int L = e->path[--tokens];
+        if (L == 1)
+            writer_literal(&e->tw, *window_at(&e->w, pos + (uint64_t)i));
+        else
+            writer_pair(&e->tw, e->found[i].dist, L);
+        i += L;
+    }
+    encoder_insert(e, pos + (uint64_t)n, stop - n);
+    return pos + (uint64_t)stop;
+}
+
+// ----------------------------------------------------------------------------
+// Decoder. Output goes to a linear buffer with N bytes of history in front of
+// it: zeros at the start of a stream (the decoder ring's initial contents, as
+// seen from rpos = N - F going backwards) or a dictionary. Every distance is at
+// most N, so once N bytes of history exist a back-reference can never leave
+// the buffer, and only input length and output room need checking.
+// ----------------------------------------------------------------------------
+
+enum
+{
+    GROUP_MAX_IN = 1 + 2 * 8,     // flag byte + 8 pairs
+    GROUP_MAX_OUT = 8 * MAX_MATCH, // 8 pairs of 18 bytes
+    COPY_SLACK = 32,               // wide copies may overrun a match by this much
+    DECODE_STAGE = 1 << 15         // streaming decoder output between slides
+};
+
+// Copies a back-reference of len bytes from dist behind d. Words are only used
+// when the source word lies entirely behind the destination word; a match can
+// write up to COPY_SLACK bytes past its end.
+static inline void copy_match(uint8_t *d, size_t dist, size_t len)
+{
+    const uint8_t *s = d - dist;
+    if (dist >= 16)
+    {
+        memcpy(d, s, 16);
+        memcpy(d + 16, s + 16, 16);
+    }
+    else if (dist >= 8)
+    {
+        memcpy(d, s, 8);
+        memcpy(d + 8, s + 8, 8);
+        memcpy(d + 16, s + 16, 8);
+    }
+    else if (dist == 1)
+        memset(d, s[0], len);
+    else
+    {
+        for (size_t i = 0; i < len; ++i)
+            d[i] = s[i];
+    }
+}
+
+#if LZSS_X86
+// Index into a distance-dist pattern for each byte of two 16-byte stores.
+static const uint8_t SHUFFLE[8][32] = {
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0},
+    {0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1},
+    {0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1},
+    {0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3},
+    {0, 1, 2, 3, 4, 0, 1, 2, 3, 4, 0, 1, 2, 3, 4, 0, 1, 2, 3, 4, 0, 1, 2, 3, 4, 0, 1, 2, 3, 4, 0, 1},
+    {0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 0, 1},
+    {0, 1, 2, 3, 4, 5, 6, 0, 1, 2, 3, 4, 5, 6, 0, 1, 2, 3, 4, 5, 6, 0, 1, 2, 3, 4, 5, 6, 0, 1, 2, 3},
+};
+
+// copy_match() for distances 2..7 without the byte loop: the dist bytes behind
+// d are repeated across two stores with one shuffle each. The load also picks
+// up bytes at and after d, which the shuffle never selects. Runs (distance 1)
+// stay with memset, which beats a load that straddles the previous stores.
+TARGET("ssse3") static inline void copy_match_ssse3(uint8_t *d, size_t dist, size_t len)
+{
+    if (dist >= 8 || dist == 1)
+    {
+        copy_match(d, dist, len);
+        return;
+    }
+    __m128i v = _mm_loadu_si128((const __m128i *)(d - dist));
+    _mm_storeu_si128((__m128i *)d, _mm_shuffle_epi8(v, _mm_loadu_si128((const __m128i *)SHUFFLE[dist])));
+    _mm_storeu_si128((__m128i *)(d + 16), _mm_shuffle_epi8(v, _mm_loadu_si128((const __m128i *)(SHUFFLE[dist] + 16))));
+}
+#else
+#define copy_match_ssse3 copy_match
+#endif
+
+// Decodes whole flag groups while a worst-case group fits in both the input
+// and the output (plus COPY_SLACK), so the loop itself needs no bounds checks.
+// Shared by every decode kernel; shuffle picks the match copy.
+static inline void decode_groups(const uint8_t *src, size_t slen, size_t *ipp, uint8_t *dst, size_t *opp, size_t limit,
+                                 bool shuffle)
+{
+    size_t ip = *ipp, op = *opp;
+    while (slen - ip >= GROUP_MAX_IN && limit - op >= GROUP_MAX_OUT)
+    {
+        unsigned flags = src[ip++];
+        if (flags == 0xFF)
+        {
+            memcpy(dst + op, src + ip, 8);
+            ip += 8;
+            op += 8;
+            continue;
+        }
+        for (int i = 0; i < 8; ++i, flags >>= 1)
+        {
+            if (flags & 1)
+            {
+                dst[op++] = src[ip++];
+                continue;
+            }
+            unsigned ofs_len = (unsigned)src[ip] | (unsigned)src[ip + 1] << 8;
+            ip += 2;
+            size_t dist = (size_t)(ofs_len >> LENGTH_BITS) + 1u;
+            size_t len = (size_t)(ofs_len & LENGTH_MASK) + THR;
+            if (shuffle)
+                copy_match_ssse3(dst + op, dist, len);
+            else
+                copy_match(dst + op, dist, len);
+            op += len;
+        }
+    }
+    *ipp = ip;
+    *opp = op;
+}
+
+static void decode_fast(const uint8_t *src, size_t slen, size_t *ipp, uint8_t *dst, size_t *opp, size_t limit)
+{
+    decode_groups(src, slen, ipp, dst, opp, limit, false);
+}
+
+#if LZSS_X86
+TARGET("ssse3") static void decode_fast_ssse3(const uint8_t *src, size_t slen, size_t *ipp, uint8_t *dst, size_t *opp,
+                                              size_t limit)
+{
+    decode_groups(src, slen, ipp, dst, opp, limit, true);
+}
+#endif
+
+typedef enum
+{
+    TAIL_END,       // input ended or output reached limit on a token boundary
+    TAIL_TRUNCATED, // input ended inside a token
+    TAIL_OVERRUN    // a match would run past limit
+} TailStatus;
+
+// Checked decoder: runs token by token until the input ends, the output
+// reaches limit, or a group finishes with op >= until. History more than hist
+// bytes behind dst reads as zero.
+static TailStatus decode_checked(const uint8_t *src, size_t slen, size_t *ipp, uint8_t *dst, size_t *opp,
+                                 size_t limit, size_t hist, size_t until)
+{
+    size_t ip = *ipp, op = *opp;
+    TailStatus st = TAIL_END;
+    while (ip < slen && op < limit && op < until && st == TAIL_END)
+    {
+        unsigned flags = src[ip++];
+        for (int i = 0; i < 8 && op < limit; ++i, flags >>= 1)
+        {
+            if (ip >= slen)
+                break;
+            if (flags & 1)
+            {
+                dst[op++] = src[ip++];
+                continue;
+            }
+            if (slen - ip < 2)
+            {
+                st = TAIL_TRUNCATED;
+                break;
+            }
+            unsigned ofs_len = (unsigned)src[ip] | (unsigned)src[ip + 1] << 8;
+            ip += 2;
+            size_t dist = (size_t)(ofs_len >> LENGTH_BITS) + 1u;
+            size_t len = (size_t)(ofs_len & LENGTH_MASK) + THR;
+            if (len > limit - op)
+            {
+                st = TAIL_OVERRUN;
+                break;
+            }
+            for (size_t j = 0; j < len; ++j, ++op)
+                dst[op] = dist <= op + hist ? dst[(ptrdiff_t)op - (ptrdiff_t)dist] : 0;
+        }
+    }
+    *ipp = ip;
+    *opp = op;
+    return st;
+}
+
+// ----------------------------------------------------------------------------
+// Kernel dispatch. The ASM build carries every variant and uses the best one
+// the CPU supports, found with CPUID on first use; lzss_simd_limit() can lower
+// it for benchmarks and cross-checks. Contexts take the kernels in effect when
+// they are initialised. All variants produce identical output.
+// ----------------------------------------------------------------------------
+
+static const Kernels KERNELS[] = {
+    [LZSS_SIMD_SCALAR] = {find_match_scan, find_match_chain, decode_fast},
+#if LZSS_X86
+    [LZSS_SIMD_SSE2] = {find_match_scan_sse2, find_match_chain_sse2, decode_fast},
+    [LZSS_SIMD_SSSE3] = {find_match_scan_sse2, find_match_chain_sse2, decode_fast_ssse3},
+    [LZSS_SIMD_AVX2] = {find_match_scan_avx2, find_match_chain_sse2, decode_fast_ssse3},
+#endif
+};
+
+static const char *const SIMD_NAMES[] = {"scalar", "sse2", "ssse3", "avx2"};
+
+static atomic_int simd_best = -1;   // what the CPU supports
+static atomic_int simd_active = -1; // what new contexts use
+
+#if LZSS_X86
+static void cpuid(unsigned leaf, unsigned sub, unsigned r[4])
+{
+#ifdef _MSC_VER
+    int v[4];
+    __cpuidex(v, (int)leaf, (int)sub);
+    for (int i = 0; i < 4; ++i)
+        r[i] = (unsigned)v[i];
+#else
+    __cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+// XCR0: which register files the OS saves on a context switch.
+static uint64_t xgetbv0(void)
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (uint64_t)hi << 32 | lo;
+#endif
+}
+#endif
+
+static int simd_detect(void)
+{
+#if LZSS_X86
+    unsigned r[4];
+    cpuid(0, 0, r);
+    unsigned max_leaf = r[0];
+    cpuid(1, 0, r);
+    bool ssse3 = r[2] >> 9 & 1;
+    bool avx_os = (r[2] >> 27 & 1) && (r[2] >> 28 & 1) && (xgetbv0() & 6) == 6; // OSXSAVE, AVX, XMM+YMM state
+    bool avx2 = false;
+    if (max_leaf >= 7)
+    {
+        cpuid(7, 0, r);
+        avx2 = r[1] >> 5 & 1;
+    }
+    return avx2 && avx_os && ssse3 ? LZSS_SIMD_AVX2 : ssse3 ? LZSS_SIMD_SSSE3 : LZSS_SIMD_SSE2;
+#else
+    return LZSS_SIMD_SCALAR;
+#endif
+}
+
+int lzss_simd_limit(int max)
+{
+    int best = atomic_load(&simd_best);
+    if (best < 0)
+    {
+        best = simd_detect();
+        atomic_store(&simd_best, best);
+    }
+    int use = max < 0 ? LZSS_SIMD_SCALAR : max < best ? max : best;
+    atomic_store(&simd_active, use);
+    return use;
+}
+
+int lzss_simd(void)
+{
+    int use = atomic_load(&simd_active);
+    return use >= 0 ? use : lzss_simd_limit(LZSS_SIMD_AVX2);
+}
+
+const char *lzss_simd_name(int simd)
+{
+    return simd >= 0 && simd <= LZSS_SIMD_AVX2 ? SIMD_NAMES[simd] : NULL;
+}
+
+static const Kernels *kernels(void)
+{
+    return &KERNELS[lzss_simd()];
+}
+
+// ----------------------------------------------------------------------------
+// Encoding
+// ----------------------------------------------------------------------------
+
+static inline uint64_t encoder_need(const Encoder *e)
+{
+    return e->level.parse == PARSE_OPTIMAL ? OPT_BLOCK + 2 * MAX_MATCH + 2 : 2 * MAX_MATCH + 3;
+}
+
+static uint64_t encoder_step(Encoder *e, uint64_t pos)
+{
+    switch (e->level.parse)
+    {
+    case PARSE_LAZY:
+        return parse_lazy(e, pos);
+    case PARSE_OPTIMAL:
+        return parse_optimal(e, pos);
+    default:
+        return parse_greedy(e, pos);
+    }
+}
+
+// Forgets the current stream: empty window, empty chains, no pending output.
+static void encoder_restart(Encoder *e)
+{
+    e->w = (Window){.store = e->window, .buf = e->window};
+    e->tw = (TokenWriter){.buf = e->pending};
+    e->pos = 0;
+    e->unhashed = 0;
+    e->drained = 0;
+    chains_init(&e->hc);
+}
+
+size_t lzss_bound(size_t len)
+{
+    return len + (len + 7) / 8;
+}
+
+const char *lzss_level_name(int level)
+{
+    return level >= 0 && level < LEVEL_COUNT ? LEVELS[level].name : NULL;
+}
+
+size_t lzss_encoder_size(void)
+{
+    return sizeof(Encoder);
+}
+
+lzss_encoder *lzss_encoder_init(void *mem, int level)
+{
+    if (!mem || level < 0 || level >= LEVEL_COUNT)
+        return NULL;
+    Encoder *e = (Encoder *)mem;
+    e->level = LEVELS[level];
+    e->k = kernels();
+    encoder_restart(e);
+    return e;
+}
+
+lzss_encoder *lzss_encoder_create(int level)
+{
+    if (level < 0 || level >= LEVEL_COUNT)
+        return NULL;
+    void *mem = malloc(sizeof(Encoder));
+    return mem ? lzss_encoder_init(mem, level) : NULL;
+}
+
+void lzss_encoder_destroy(lzss_encoder *e)
+{
+    free(e);
+}
+
+lzss_status lzss_encoder_prime(lzss_encoder *e, const void *dict, size_t len)
+{
+    if (!e || (len && !dict))
+        return LZSS_E_PARAM;
+    encoder_restart(e);
+    if (len > N)
+    {
+        dict = (const uint8_t *)dict + (len - N);
+        len = N;
+    }
+    memcpy(e->window, dict, len);
+    e->w.end = len;
+    e->pos = len; // the last two primed positions are hashed once data follows
+    return LZSS_OK;
+}
+
+// Hands out finished output: everything before the open group's flag byte.
+static size_t encoder_deliver(Encoder *e, uint8_t *out, size_t cap)
+{
+    size_t ready = (e->tw.mask ? e->tw.flag_at : e->tw.len) - e->drained;
+    size_t n = ready < cap ? ready : cap;
+    memcpy(out, e->pending + e->drained, n);
+    e->drained += n;
+    if (e->drained == e->tw.len || OUT_CAP - e->tw.len < STEP_MAX_OUT)
+    {
+        memmove(e->pending, e->pending + e->drained, e->tw.len - e->drained);
+        e->tw.len -= e->drained;
+        e->tw.flag_at -= e->tw.mask ? e->drained : 0;
+        e->drained = 0;
+    }
+    return n;
+}
+
+lzss_status lzss_encoder_run(lzss_encoder *e, const void *in, size_t *in_len,
+                             void *out, size_t *out_len, bool finish)
+{
+    if (!e || !in_len || !out_len || (*in_len && !in) || (*out_len && !out))
+        return LZSS_E_PARAM;
+    const uint8_t *src = (const uint8_t *)in;
+    uint8_t *dst = (uint8_t *)out;
+    size_t taken = 0, given = 0;
+    uint64_t need = encoder_need(e);
+
+    for (;;)
+    {
+        if (OUT_CAP - e->tw.len < STEP_MAX_OUT)
+        {
+            given += encoder_deliver(e, dst + given, *out_len - given);
+            if (OUT_CAP - e->tw.len < STEP_MAX_OUT)
+                break; // caller has to make room
+        }
+        if (!e->w.eof && e->w.end - e->pos < need)
+        {
+            taken += window_push(&e->w, e->pos, src + taken, *in_len - taken);
+            e->w.eof = finish && taken == *in_len;
+        }
+        if (e->pos < e->w.end && (e->w.eof || e->w.end - e->pos >= need))
+        {
+            if (e->unhashed < e->pos)
+            {
+                encoder_insert(e, e->unhashed, (int)(e->pos - e->unhashed));
+                e->unhashed = e->pos;
+            }
+            e->pos = encoder_step(e, e->pos);
+            e->unhashed = e->pos;
+            continue;
+        }
+        if (e->w.eof && e->pos >= e->w.end)
+            e->tw.mask = 0; // input is over: the last group stays short
+        break;
+    }
+
+    given += encoder_deliver(e, dst + given, *out_len - given);
+    *in_len = taken;
+    *out_len = given;
+    if (e->w.eof && e->pos >= e->w.end && e->tw.len == 0)
+    {
+        encoder_restart(e);
+        return LZSS_END;
+    }
+    return LZSS_OK;
+}
+
+int64_t lzss_compress_ctx(lzss_encoder *e, const void *src, size_t len, size_t hist, void *dst, size_t cap)
+{
+    if (!e || hist > N || (len && (!src || !dst)))
+        return LZSS_E_PARAM;
+    const uint8_t *base = (const uint8_t *)src - hist;
+    if (cap >= lzss_bound(len))
+    {
+        // Everything fits: parse the caller's buffer in place.
+        e->w = (Window){.buf = base, .end = hist + len, .eof = true};
+        e->tw = (TokenWriter){.buf = (uint8_t *)dst};
+        chains_init(&e->hc);
+        encoder_insert(e, 0, (int)hist);
+        for (uint64_t pos = hist; pos < e->w.end;)
+            pos = encoder_step(e, pos);
+        size_t produced = e->tw.len;
+        encoder_restart(e);
+        return (int64_t)produced;
+    }
+
+    lzss_encoder_prime(e, base, hist);
+    size_t in_len = len, out_len = cap;
+    lzss_status st = lzss_encoder_run(e, src, &in_len, dst, &out_len, true);
+    if (st != LZSS_END)
+    {
+        encoder_restart(e);
+        return LZSS_E_DST_SIZE;
+    }
+    return (int64_t)out_len;
+}
+
+int64_t lzss_compress(const void *src, size_t len, void *dst, size_t cap, int level)
+{
+    if (level < 0 || level >= LEVEL_COUNT)
+        return LZSS_E_PARAM;
+    Encoder *e = lzss_encoder_create(level);
+    if (!e)
+        return LZSS_E_NOMEM;
+    int64_t n = lzss_compress_ctx(e, src, len, 0, dst, cap);
+    lzss_encoder_destroy(e);
+    return n;
+}
+
+// ----------------------------------------------------------------------------
+// Decoding into caller memory
+// ----------------------------------------------------------------------------
+
+int64_t lzss_decompress_hist(const void *src, size_t len, void *dst, size_t cap, size_t hist)
+{
+    if (hist > N || (len && !src) || (cap && !dst))
+        return LZSS_E_PARAM;
+    const uint8_t *in = (const uint8_t *)src;
+    uint8_t *out = (uint8_t *)dst;
+    size_t ip = 0, op = 0;
+
+    // Until N bytes of history exist in the buffer, reads may fall before it.
+    TailStatus st = decode_checked(in, len, &ip, out, &op, cap, hist, hist < N ? N - hist : 0);
+    if (st == TAIL_END && cap - op > COPY_SLACK)
+        kernels()->decode(in, len, &ip, out, &op, cap - COPY_SLACK);
+    if (st == TAIL_END)
+        st = decode_checked(in, len, &ip, out, &op, cap, hist, SIZE_MAX);
+
+    // Input left over once dst is full is only an error if it still holds a
+    // whole token: a last flag byte, or a pair cut off by the end of the
+    // input, ends the stream without output.
+    if (st == TAIL_OVERRUN || (st == TAIL_END && ip < len && lzss_raw_size(src, len) > op))
+        return LZSS_E_DST_SIZE;
+    return (int64_t)op;
+}
+
+int64_t lzss_decompress(const void *src, size_t len, void *dst, size_t cap)
+{
+    return lzss_decompress_hist(src, len, dst, cap, 0);
+}
+
+// ----------------------------------------------------------------------------
+// Streaming decoder. Output is staged in win[N, N + DECODE_STAGE) behind N
+// bytes of history and handed out from there; once the stage is drained, its
+// last N bytes slide to the front. A group split across input pushes is
+// collected in part[].
+// ----------------------------------------------------------------------------
+
+struct lzss_decoder
+{
+    const Kernels *k;
+    size_t wpos;                // end of decoded output in win
+    size_t rpos;                // output handed out up to here
+    size_t part_len;            // bytes of an incomplete group in part[]
+    uint8_t part[GROUP_MAX_IN];
+    uint8_t win[N + DECODE_STAGE + COPY_SLACK];
+};
+typedef struct lzss_decoder Decoder;
+
+// Input bytes of the group introduced by flags: 1 per literal, 2 per pair.
+static inline size_t group_len(uint8_t flags)
+{
+    size_t literals = 0;
+    for (; flags; flags &= (uint8_t)(flags - 1))
+        ++literals;
+    return GROUP_MAX_IN - literals;
+}
+
+static void decoder_restart(Decoder *d)
+{
+    memset(d->win, 0x00, N); // zeroed history
+    d->wpos = d->rpos = N;
+    d->part_len = 0;
+}
+
+size_t lzss_decoder_size(void)
+{
+    return sizeof(Decoder);
+}
+
+lzss_decoder *lzss_decoder_init(void *mem)
+{
+    if (!mem)
+        return NULL;
+    ((Decoder *)mem)->k = kernels();
+    decoder_restart((Decoder *)mem);
+    return (Decoder *)mem;
+}
+
+lzss_decoder *lzss_decoder_create(void)
+{
+    void *mem = malloc(sizeof(Decoder));
+    return mem ? lzss_decoder_init(mem) : NULL;
+}
+
+void lzss_decoder_destroy(lzss_decoder *d)
+{
+    free(d);
+}
+
+lzss_status lzss_decoder_prime(lzss_decoder *d, const void *dict, size_t len)
+{
+    if (!d || (len && !dict))
+        return LZSS_E_PARAM;
+    decoder_restart(d);
+    if (len > N)
+    {
+        dict = (const uint8_t *)dict + (len - N);
+        len = N;
+    }
+    memcpy(d->win + N - len, dict, len);
+    return LZSS_OK;
+}
+
+lzss_status lzss_decoder_run(lzss_decoder *d, const void *in, size_t *in_len,
+                             void *out, size_t *out_len, bool finish)
+{
+    if (!d || !in_len || !out_len || (*in_len && !in) || (*out_len && !out))
+        return LZSS_E_PARAM;
+    const uint8_t *src = (const uint8_t *)in;
+    uint8_t *dst = (uint8_t *)out;
+    size_t ip = 0, given = 0;
+    bool ended = false;
+
+    for (;;)
+    {
+        size_t n = d->wpos - d->rpos;
+        if (n > *out_len - given)
+            n = *out_len - given;
+        memcpy(dst + given, d->win + d->rpos, n);
+        given += n;
+        d->rpos += n;
+        if (d->rpos == d->wpos && d->wpos > N + DECODE_STAGE - GROUP_MAX_OUT)
+        {
+            memmove(d->win, d->win + d->wpos - N, N);
+            d->wpos = d->rpos = N;
+        }
+        if (ended || N + DECODE_STAGE - d->wpos < GROUP_MAX_OUT)
+            break;
+
+        if (d->part_len == 0 && *in_len - ip >= GROUP_MAX_IN)
+        {
+            d->k->decode(src, *in_len, &ip, d->win, &d->wpos, N + DECODE_STAGE);
+            continue;
+        }
+
+        // Fewer than a worst-case group left: assemble the next group in part[].
+        if (d->part_len == 0 && ip < *in_len)
+            d->part[d->part_len++] = src[ip++];
+        if (d->part_len == 0)
+        {
+            if (!finish)
+                break; // need more input
+            ended = true;
+            continue;
+        }
+        size_t want = group_len(d->part[0]) - d->part_len;
+        size_t take = want < *in_len - ip ? want : *in_len - ip;
+        memcpy(d->part + d->part_len, src + ip, take);
+        d->part_len += take;
+        ip += take;
+        if (take == want)
+        {
+            size_t pp = 0;
+            d->k->decode(d->part, GROUP_MAX_IN, &pp, d->win, &d->wpos, N + DECODE_STAGE);
+            d->part_len = 0;
+        }
+        else if (finish)
+        {
+            // The stream ends inside this group, as every stream's last group may.
+            size_t pp = 0;
+            decode_checked(d->part, d->part_len, &pp, d->win, &d->wpos, N + DECODE_STAGE, N, SIZE_MAX);
+            d->part_len = 0;
+            ended = true;
+        }
+        else
+            break; // need more input
+    }
+
+    *in_len = ip;
+    *out_len = given;
+    if (ended && d->rpos == d->wpos)
+    {
+        decoder_restart(d);
+        return LZSS_END;
+    }
+    return LZSS_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Random access. A checkpoint index lets lzss_extract() start decoding near
+// the requested range instead of at byte 0. It is built from the finished
+// stream, so it can be added to any existing .lzs file.
+//
+//   0   "LZSI"
+//   4   u8  version (1)
+//   5   u8  reserved (0)
+//   6   u16 reserved (0)
+//   8   u32 interval
+//   12  u32 checkpoint count
+//   16  u64 raw size of the stream
+//   24  u64 packed size of the stream
+//   32  checkpoints, 32 bytes each:
+//         0   u64 raw offset
+//         8   u64 offset of the flag byte of the group the next token is in
+//         16  u64 snapshot offset, from the start of the index
+//         24  u16 snapshot size
+//         26  u8  the next token's flag bit (0..7)
+//         27  u8  reserved (0), then u32 reserved (0)
+//   ..  snapshots
+//
+// Integers are little-endian. Checkpoint k (k = 1, 2, ...) sits on the first
+// token boundary at or after k * interval. Its snapshot is the N output bytes
+// in front of it, stored as a raw stream; equal consecutive snapshots are
+// stored once.
+// ----------------------------------------------------------------------------
+
+enum
+{
+    INDEX_VERSION = 1,
+    INDEX_HEADER = 32,
+    INDEX_ENTRY = 32
+};
+
+static const uint8_t INDEX_MAGIC[4] = {'L', 'Z', 'S', 'I'};
+
+static inline void put_u16(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+static inline void put_u64(uint8_t *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint32_t get_u16(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | get_u16(p + 2) << 16;
+}
+
+static inline uint64_t get_u64(const uint8_t *p)
+{
+    return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+// A token boundary inside a stream.
+typedef struct
+{
+    size_t flag_at; // the current group's flag byte
+    size_t ip;      // the next token
+    unsigned bit;   // the next token's flag bit
+} Cursor;
+
+// Places a cursor at flag bit `bit` of the group at flag_at. Returns false if
+// the tokens in front of it run past len.
+static bool cursor_at(const uint8_t *src, size_t len, size_t flag_at, unsigned bit, Cursor *c)
+{
+    *c = (Cursor){.flag_at = flag_at, .ip = flag_at + 1, .bit = bit};
+    if (bit == 0)
+        return flag_at <= len;
+    if (flag_at >= len)
+        return false;
+    for (unsigned i = 0; i < bit; ++i)
+        c->ip += (src[flag_at] >> i & 1) ? 1 : 2;
+    return c->ip <= len;
+}
+
+// Decodes the token at c and moves c past it. Returns false, writing nothing,
+// once the stream has ended: at the end of the input or at a token cut off by
+// it. The caller keeps MAX_MATCH bytes of room and N bytes of history.
+static bool decode_token(const uint8_t *src, size_t len, Cursor *c, uint8_t *dst, size_t *opp)
+{
+    if (c->ip >= len)
+        return false;
+    size_t op = *opp;
+    if (src[c->flag_at] >> c->bit & 1)
+        dst[op++] = src[c->ip++];
+    else
+    {
+        if (len - c->ip < 2)
+            return false;
+        unsigned ofs_len = (unsigned)src[c->ip] | (unsigned)src[c->ip + 1] << 8;
+        c->ip += 2;
+        size_t dist = (size_t)(ofs_len >> LENGTH_BITS) + 1u;
+        size_t end = op + (ofs_len & LENGTH_MASK) + THR;
+        for (; op < end; ++op)
+            dst[op] = dst[op - dist];
+    }
+    *opp = op;
+    if (++c->bit == 8)
+        *c = (Cursor){.flag_at = c->ip, .ip = c->ip + 1};
+    return true;
+}
+
+uint64_t lzss_raw_size(const void *src, size_t len)
+{
+    const uint8_t *in = (const uint8_t *)src;
+    uint64_t raw = 0;
+    size_t ip = 0;
+    while (in && ip < len)
+    {
+        unsigned flags = in[ip++];
+        if (flags == 0xFF && len - ip >= 8)
+        {
+            ip += 8;
+            raw += 8;
+            continue;
+        }
+        for (int i = 0; i < 8 && ip < len; ++i, flags >>= 1)
+        {
+            if (flags & 1)
+            {
+                ++ip;
+                ++raw;
+                continue;
+            }
+            if (len - ip < 2)
+                return raw;
+            raw += (in[ip] & LENGTH_MASK) + THR;
+            ip += 2;
+        }
+    }
+    return raw;
+}
+
+static uint64_t index_checkpoints(uint64_t raw_size, uint32_t interval)
+{
+    return raw_size ? (raw_size - 1) / interval : 0;
+}
+
+size_t lzss_index_bound(uint64_t raw_size, uint32_t interval)
+{
+    if (interval < LZSS_INDEX_INTERVAL_MIN)
+        return 0;
+    return INDEX_HEADER + (size_t)index_checkpoints(raw_size, interval) * (INDEX_ENTRY + lzss_bound(N));
+}
+
+int64_t lzss_index_build(const void *src, size_t len, uint32_t interval, void *dst, size_t cap)
+{
+    if ((len && !src) || (cap && !dst) || interval < LZSS_INDEX_INTERVAL_MIN)
+        return LZSS_E_PARAM;
+    const uint8_t *in = (const uint8_t *)src;
+    uint8_t *out = (uint8_t *)dst;
+    uint64_t raw_size = lzss_raw_size(src, len);
+    uint64_t count = index_checkpoints(raw_size, interval);
+    if (count > UINT32_MAX)
+        return LZSS_E_PARAM;
+    if (cap < INDEX_HEADER || (cap - INDEX_HEADER) / INDEX_ENTRY < count)
+        return LZSS_E_DST_SIZE;
+
+    Decoder *d = lzss_decoder_create();
+    Encoder *e = lzss_encoder_create(LZSS_LEVEL_FAST);
+    uint8_t *last = (uint8_t *)malloc(N); // previous snapshot
+    if (!d || !e || !last)
+    {
+        free(last);
+        lzss_encoder_destroy(e);
+        lzss_decoder_destroy(d);
+        return LZSS_E_NOMEM;
+    }
+
+    // Decode through the decoder's stage: win[N, op) is stream bytes base.. on.
+    // Whole groups go through the fast kernel; the approach to a checkpoint and
+    // the rest of its group go token by token.
+    const size_t stage_end = N + DECODE_STAGE;
+    Cursor c = {.ip = 1};
+    uint64_t base = 0;
+    size_t op = N;
+    size_t at = INDEX_HEADER + (size_t)count * INDEX_ENTRY;
+    size_t last_at = 0, last_len = 0;
+    int64_t result = 0;
+    for (uint64_t k = 1; k <= count && result == 0; ++k)
+    {
+        uint64_t target = k * interval;
+        while (base + (op - N) < target)
+        {
+            if (stage_end - op < GROUP_MAX_OUT)
+            {
+                memmove(d->win, d->win + op - N, N);
+                base += op - N;
+                op = N;
+            }
+            uint64_t until = N + (target - base);
+            size_t limit = until < stage_end ? (size_t)until : stage_end;
+            size_t before = op;
+            if (c.bit == 0 && c.flag_at < len)
+            {
+                size_t ip = c.flag_at;
+                d->k->decode(in, len, &ip, d->win, &op, limit);
+                c = (Cursor){.flag_at = ip, .ip = ip + 1};
+            }
+            if (op == before && !decode_token(in, len, &c, d->win, &op))
+                break; // cannot happen: count comes from the same walk
+        }
+
+        const uint8_t *snap = d->win + op - N;
+        uint8_t *entry = out + INDEX_HEADER + (size_t)(k - 1) * INDEX_ENTRY;
+        if (last_len == 0 || memcmp(snap, last, N) != 0)
+        {
+            int64_t n = at < cap ? lzss_compress_ctx(e, snap, N, 0, out + at, cap - at) : LZSS_E_DST_SIZE;
+            if (n < 0)
+            {
+                result = n;
+                break;
+            }
+            memcpy(last, snap, N);
+            last_at = at;
+            last_len = (size_t)n;
+            at += (size_t)n;
+        }
+        memset(entry, 0, INDEX_ENTRY);
+        put_u64(entry, base + (op - N));
+        put_u64(entry + 8, c.flag_at);
+        put_u64(entry + 16, last_at);
+        put_u16(entry + 24, (uint32_t)last_len);
+        entry[26] = (uint8_t)c.bit;
+    }
+
+    if (result == 0)
+    {
+        memcpy(out, INDEX_MAGIC, 4);
+        out[4] = INDEX_VERSION;
+        memset(out + 5, 0, 3);
+        put_u32(out + 8, interval);
+        put_u32(out + 12, (uint32_t)count);
+        put_u64(out + 16, raw_size);
+        put_u64(out + 24, len);
+        result = (int64_t)at;
+    }
+    free(last);
+    lzss_encoder_destroy(e);
+    lzss_decoder_destroy(d);
+    return result;
+}
+
+int64_t lzss_extract(const void *src, size_t len, const void *index, size_t index_len, uint64_t offset, void *dst,
+                     size_t n)
+{
+    if ((len && !src) || (index_len && !index) || (n && !dst))
+        return LZSS_E_PARAM;
+    const uint8_t *in = (const uint8_t *)src;
+    const uint8_t *ix = (const uint8_t *)index;
+    if (index_len < INDEX_HEADER || memcmp(ix, INDEX_MAGIC, 4) != 0 || ix[4] != INDEX_VERSION)
+        return LZSS_E_INDEX;
+    uint64_t count = get_u32(ix + 12);
+    uint64_t raw_size = get_u64(ix + 16);
+    if (get_u32(ix + 8) < LZSS_INDEX_INTERVAL_MIN || get_u64(ix + 24) != len ||
+        (index_len - INDEX_HEADER) / INDEX_ENTRY < count)
+        return LZSS_E_INDEX;
+    if (offset >= raw_size)
+        return 0;
+    if (n > raw_size - offset)
+        n = (size_t)(raw_size - offset);
+    if (n == 0)
+        return 0;
+
+    // Last checkpoint at or before offset; none means the start of the stream.
+    uint64_t lo = 0, hi = count;
+    while (lo < hi)
+    {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (get_u64(ix + INDEX_HEADER + mid * INDEX_ENTRY) <= offset)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    Decoder *d = lzss_decoder_create();
+    if (!d)
+        return LZSS_E_NOMEM;
+    Cursor c = {.ip = 1};
+    uint64_t pos = 0;
+    if (lo > 0)
+    {
+        const uint8_t *entry = ix + INDEX_HEADER + (lo - 1) * INDEX_ENTRY;
+        pos = get_u64(entry);
+        uint64_t flag_at = get_u64(entry + 8), snap_at = get_u64(entry + 16);
+        size_t snap_len = get_u16(entry + 24);
+        if (flag_at > len || entry[26] > 7 || snap_at > index_len || index_len - snap_at < snap_len ||
+            !cursor_at(in, len, (size_t)flag_at, entry[26], &c) ||
+            lzss_decompress(ix + snap_at, snap_len, d->win, N) != N)
+        {
+            lzss_decoder_destroy(d);
+            return LZSS_E_INDEX;
+        }
+    }
+
+    // Finish the checkpoint's group by hand, then run the streaming decoder
+    // from the next flag byte, dropping output until offset.
+    while (c.bit != 0 && decode_token(in, len, &c, d->win, &d->wpos))
+        ;
+    size_t ip = c.bit == 0 && c.flag_at < len ? c.flag_at : len;
+    uint64_t skip = offset - pos;
+    size_t got = 0;
+    lzss_status st = LZSS_OK;
+    while (st == LZSS_OK && got < n)
+    {
+        size_t ready = d->wpos - d->rpos;
+        size_t drop = skip < ready ? (size_t)skip : ready;
+        d->rpos += drop;
+        skip -= drop;
+        size_t in_len = len - ip, out_len = skip ? 0 : n - got;
+        st = lzss_decoder_run(d, in + ip, &in_len, (uint8_t *)dst + got, &out_len, true);
+        ip += in_len;
+        got += out_len;
+    }
+    lzss_decoder_destroy(d);
+    return got == n ? (int64_t)got : LZSS_E_INDEX;
+}
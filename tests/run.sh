@@ -0,0 +1,176 @@
+#!/usr/bin/env bash
+# Regression tests: the library checks in test_lib.c, the C++ dialects in
+# test_cpp.cpp, then the CLI on small hand-made inputs. Needs the same
+# compilers as build.sh (CC and CXX override them).
+#   ./tests/run.sh
+set -euo pipefail
+
+ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
+CC="${CC:-clang}"
+CXX="${CXX:-clang++}"
+WORK="$(mktemp -d)"
+trap 'rm -rf "$WORK"' EXIT
+
+$CC -std=c2x -O2 -pthread -o "$WORK/test_lib" "$ROOT/tests/test_lib.c" "$ROOT/lzss_lib.c"
+$CC -std=c2x -O2 -pthread -o "$WORK/lzss" "$ROOT/lzss.c" "$ROOT/lzss_lib.c"
+"$WORK/test_lib"
+# The ASM build adds the SIMD kernels; test_lib compares them with scalar.
+if [[ "$(uname -m)" == x86_64 ]]; then
+    $CC -std=c2x -O2 -DASM_MODE=1 -pthread -o "$WORK/test_lib_asm" "$ROOT/tests/test_lib.c" "$ROOT/lzss_lib.c"
+    "$WORK/test_lib_asm"
+fi
+
+# The C++ dialects against the C library and the 1989 LZSS.C.
+$CC -std=c2x -O2 -c -o "$WORK/lzss_lib.o" "$ROOT/lzss_lib.c"
+$CC -std=c2x -O2 -c -o "$WORK/bench_1989.o" "$ROOT/bench/bench_1989.c"
+$CXX -std=c++2b -O2 -o "$WORK/test_cpp" "$ROOT/tests/test_cpp.cpp" "$WORK/lzss_lib.o" "$WORK/bench_1989.o"
+"$WORK/test_cpp"
+
+LZSS="$WORK/lzss"
+FAILED=0
+fail() { echo "FAIL: $*" >&2; FAILED=1; }
+
+# --- container random access ------------------------------------------------
+seq 1 2000 | head -c 3072 > "$WORK/c.raw"
+head -c 3072 /dev/zero > "$WORK/z.raw"
+"$LZSS" e -c -b 1 "$WORK/c.raw" "$WORK/c.lzb"
+"$LZSS" x "$WORK/c.lzb" 1000 1100 "$WORK/c.part" || fail "x on a container"
+cmp -s "$WORK/c.part" <(tail -c +1001 "$WORK/c.raw" | head -c 1100) || fail "x output on a container"
+
+# A container needs its input's size up front: a pipe is refused and leaves
+# no output behind. Several threads give the same bytes as one.
+cat "$WORK/c.raw" | "$LZSS" e -c /dev/stdin "$WORK/pipe.lzb" 2>/dev/null && fail "e -c accepted a pipe"
+[[ ! -e "$WORK/pipe.lzb" ]] || fail "e -c on a pipe left an output file"
+"$LZSS" e -c -b 1 -t 4 "$WORK/c.raw" "$WORK/c4.lzb" || fail "e -c -t 4"
+cmp -s "$WORK/c.lzb" "$WORK/c4.lzb" || fail "e -c -t 4 output differs from one thread"
+"$LZSS" d -t 4 "$WORK/c4.lzb" "$WORK/c4.out" && cmp -s "$WORK/c4.out" "$WORK/c.raw" || fail "d -t 4 on a container"
+
+# Batches are sized to the blocks there are: one 2 MB block on 64 threads
+# fits in 300 MB of address space.
+(ulimit -v 300000; "$LZSS" e -c -b 2048 -t 64 "$WORK/c.raw" "$WORK/c64.lzb" &&
+    "$LZSS" d -t 64 "$WORK/c64.lzb" "$WORK/c64.out") 2>/dev/null || fail "one block on 64 threads"
+cmp -s "$WORK/c64.out" "$WORK/c.raw" || fail "one block on 64 threads output"
+
+# x through a checkpoint index every 4 KB gives the same bytes as d, on
+# either side of a checkpoint and up to the end of the stream.
+"$LZSS" e -l 3 "$ROOT/lzss_lib.c" "$WORK/lib.lzs"
+"$LZSS" d "$WORK/lib.lzs" "$WORK/lib.raw"
+"$LZSS" i -b 4 "$WORK/lib.lzs" "$WORK/lib.lzs.idx" || fail "i -b 4"
+for range in "0 100" "4090 20" "12345 6789" "40000 1000000"; do
+    set -- $range
+    "$LZSS" x "$WORK/lib.lzs" "$1" "$2" "$WORK/lib.part" || fail "x $range"
+    cmp -s "$WORK/lib.part" <(tail -c +$(($1 + 1)) "$WORK/lib.raw" | head -c "$2") || fail "x $range output"
+done
+
+# A corrupt middle block or an index made for another stream fails x with
+# exit 2 and no output, rather than a short file.
+cp "$WORK/c.lzb" "$WORK/bad.lzb"
+packed0=$(od -An -tu4 -j24 -N4 "$WORK/c.lzb" | tr -d ' ')
+packed1=$(od -An -tu4 -j32 -N4 "$WORK/c.lzb" | tr -d ' ')
+head -c "$packed1" /dev/zero | dd of="$WORK/bad.lzb" bs=1 seek=$((24 + 3 * 8 + packed0)) conv=notrunc status=none
+"$LZSS" x "$WORK/bad.lzb" 0 3072 "$WORK/bad.part" 2>/dev/null && fail "x accepted a corrupt block"
+[[ ! -e "$WORK/bad.part" ]] || fail "x left a partial output for a corrupt block"
+"$LZSS" d "$WORK/bad.lzb" "$WORK/bad.out" 2>/dev/null && fail "d accepted a corrupt block"
+[[ ! -e "$WORK/bad.out" ]] || fail "d left a partial output for a corrupt block"
+"$LZSS" e "$WORK/c.raw" "$WORK/c.lzs"
+"$LZSS" e "$WORK/z.raw" "$WORK/z.lzs"
+"$LZSS" i "$WORK/z.lzs" "$WORK/z.idx"
+"$LZSS" x -i "$WORK/z.idx" "$WORK/c.lzs" 0 3072 "$WORK/wrong.part" 2>/dev/null && fail "x accepted another stream's index"
+[[ ! -e "$WORK/wrong.part" ]] || fail "x left a partial output for another stream's index"
+
+# A failed run deletes only a regular file it wrote: a symbolic link as the
+# output is left in place, and so is a device.
+printf 'keep' > "$WORK/target"
+ln -s "$WORK/target" "$WORK/link"
+"$LZSS" d "$WORK/bad.lzb" "$WORK/link" 2>/dev/null && fail "d through a link accepted a corrupt block"
+[[ -L "$WORK/link" && -e "$WORK/target" ]] || fail "a failed d removed the output link or its target"
+"$LZSS" d "$WORK/bad.lzb" /dev/null 2>/dev/null && fail "d to /dev/null accepted a corrupt block"
+[[ -c /dev/null ]] || fail "a failed d removed /dev/null"
+
+# A short middle block (raw size 200 of 1024, total adjusted to match) is
+# rejected instead of being read as a full one. Zeros keep every packed
+# block within the bound of 200 raw bytes.
+"$LZSS" e -c -b 1 "$WORK/z.raw" "$WORK/short.lzb"
+printf '\xc8\x00\x00\x00' | dd of="$WORK/short.lzb" bs=1 seek=$((24 + 8 + 4)) conv=notrunc status=none
+printf '\xc8\x08\x00\x00\x00\x00\x00\x00' | dd of="$WORK/short.lzb" bs=1 seek=16 conv=notrunc status=none
+"$LZSS" x "$WORK/short.lzb" 2000 1000 "$WORK/short.part" 2>/dev/null && fail "x accepted a short middle block"
+"$LZSS" d "$WORK/short.lzb" "$WORK/short.out" 2>/dev/null && fail "d accepted a short middle block"
+
+# A raw stream whose first flag byte is 'L' (pair, pair, two literals, ...)
+# is still decoded, indexed and extracted as a raw stream.
+printf 'L\x00\x00\x00\x00ab\x00\x00\x00\x00c\x00\x00' > "$WORK/l.lzs"
+{ head -c 6 /dev/zero; printf 'abbbbbbbcccc'; } > "$WORK/l.raw"
+"$LZSS" d "$WORK/l.lzs" "$WORK/l.out" || fail "d on a raw stream starting with L"
+cmp -s "$WORK/l.out" "$WORK/l.raw" || fail "d output on a raw stream starting with L"
+"$LZSS" i "$WORK/l.lzs" "$WORK/l.lzs.idx" || fail "i on a raw stream starting with L"
+"$LZSS" x "$WORK/l.lzs" 4 6 "$WORK/l.part" || fail "x on a raw stream starting with L"
+cmp -s "$WORK/l.part" <(tail -c +5 "$WORK/l.raw" | head -c 6) || fail "x output on a raw stream starting with L"
+
+# --- options ----------------------------------------------------------------
+# Container options on a raw encode are refused rather than ignored; d -t
+# still applies to containers.
+for opts in "-t 2" "-b 64" "-D $WORK/c.raw"; do
+    "$LZSS" e $opts "$WORK/c.raw" "$WORK/o.lzs" 2>/dev/null && fail "e $opts accepted without -c"
+done
+"$LZSS" e -c -t 2 -D "$WORK/c.raw" "$WORK/c.raw" "$WORK/o.lzb" || fail "e -c -t -D"
+"$LZSS" d -t 2 "$WORK/o.lzb" "$WORK/o.out" || fail "d -t on a container"
+cmp -s "$WORK/o.out" "$WORK/c.raw" || fail "d -t output on a container"
+
+# So are -i, -D and -k where they would do nothing, and numbers with
+# trailing junk. None of these leaves an output behind.
+for args in "d -i $WORK/o.idx $WORK/o.lzb" "d -D $WORK/c.raw $WORK/o.lzb" "u -D $WORK/c.raw $WORK/in.lza" \
+    "x -i $WORK/o.idx $WORK/o.lzb 0 10" "e -c -t 4x $WORK/c.raw" "e -c -b 64K $WORK/c.raw" "e -k avx2 $WORK/c.raw"; do
+    "$LZSS" $args "$WORK/bad.out" 2>/dev/null && fail "$args accepted"
+    [[ ! -e "$WORK/bad.out" ]] || fail "$args left an output file"
+    rm -f "$WORK/bad.out"
+done
+"$LZSS" e -k scalar "$WORK/c.raw" "$WORK/k.lzs" || fail "e -k scalar"
+
+# d maps a regular file and reads anything else; both give the same bytes.
+"$LZSS" e -l 4 "$ROOT/lzss.c" "$WORK/src.lzs"
+"$LZSS" d "$WORK/src.lzs" "$WORK/src.mapped" || fail "d on a mapped file"
+cat "$WORK/src.lzs" | "$LZSS" d /dev/stdin "$WORK/src.piped" || fail "d on a pipe"
+cmp -s "$WORK/src.mapped" "$ROOT/lzss.c" && cmp -s "$WORK/src.piped" "$ROOT/lzss.c" || fail "d output, mapped or piped"
+
+# --- batch ------------------------------------------------------------------
+# u decodes a tree file whose stream ends in half a pair, as d does.
+mkdir -p "$WORK/tree/sub"
+printf '\x01A\x00' > "$WORK/tree/sub/a.lzs"
+"$LZSS" u "$WORK/tree" "$WORK/untree" || fail "u on a stream ending in half a pair"
+[[ "$(cat "$WORK/untree/sub/a" 2>/dev/null)" == "A" ]] || fail "u output of a stream ending in half a pair"
+
+# An input that cannot be read is reported and left out of the archive.
+mkdir -p "$WORK/in"
+printf 'hello hello hello' > "$WORK/in/good"
+printf 'good\nmissing\n' > "$WORK/list"
+(cd "$WORK/in" && "$LZSS" a -c @../list ../in.lza 2>/dev/null) && fail "a -c with a missing file exits 0"
+"$LZSS" u "$WORK/in.lza" "$WORK/out" || fail "u of an archive with a failed file"
+[[ ! -e "$WORK/out/missing" ]] || fail "u recreated a file that failed to compress"
+cmp -s "$WORK/in/good" "$WORK/out/good" || fail "u output of the good file"
+
+# An entry whose raw size its packed size could never reach is rejected when
+# the table of contents is read, before anything is allocated for it.
+cp "$WORK/in.lza" "$WORK/huge.lza"
+toc=$(od -An -tu8 -j16 -N8 "$WORK/in.lza" | tr -d ' ')
+printf '\x00\x00\x00\x00\x00\x04\x00\x00' | dd of="$WORK/huge.lza" bs=1 seek=$((toc + 8)) conv=notrunc status=none
+"$LZSS" u "$WORK/huge.lza" "$WORK/huge" 2>"$WORK/huge.err" && fail "u accepted a 4 TB entry"
+grep -q "corrupt archive" "$WORK/huge.err" || fail "u on a 4 TB entry: $(cat "$WORK/huge.err")"
+
+# Two entries for one path are rejected rather than written twice.
+mkdir -p "$WORK/dup"
+printf 'first' > "$WORK/dup/aa"
+printf 'second' > "$WORK/dup/ab"
+"$LZSS" a -c "$WORK/dup" "$WORK/dup.lza" || fail "a -c of two files"
+toc=$(od -An -tu8 -j16 -N8 "$WORK/dup.lza" | tr -d ' ')
+printf 'aa' | dd of="$WORK/dup.lza" bs=1 seek=$((toc + 2 * 26 + 2)) conv=notrunc status=none
+"$LZSS" u "$WORK/dup.lza" "$WORK/undup" 2>"$WORK/dup.err" && fail "u accepted a duplicate path"
+grep -q "duplicate path" "$WORK/dup.err" || fail "u on a duplicate path: $(cat "$WORK/dup.err")"
+
+# An archive that cannot be written in full fails and is not left behind.
+mkdir -p "$WORK/big"
+for i in 1 2 3 4; do cp "$ROOT/lzss.c" "$WORK/big/$i.c"; done
+(trap '' XFSZ; ulimit -f 8; "$LZSS" a -c "$WORK/big" "$WORK/big.lza" 2>/dev/null) && fail "a -c past the file size limit exits 0"
+[[ ! -e "$WORK/big.lza" ]] || fail "a -c left a partial archive"
+
+[[ $FAILED == 0 ]] && echo "test_cli: ok"
+exit $FAILED
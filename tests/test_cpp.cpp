@@ -0,0 +1,133 @@
+// test_cpp.cpp — regression tests for the C++ dialects (lzss.hpp)
+// Run through tests/run.sh, linked with lzss_lib.c and bench/bench_1989.c.
+// Prints each failed check and exits 1 if any.
+
+#include "../lzss.hpp"
+#include "../lzss.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <vector>
+
+// bench/bench_1989.c
+extern "C" std::size_t lzss1989_encode(std::FILE *in, std::FILE *out);
+extern "C" void lzss1989_decode(std::FILE *in, std::FILE *out);
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond);                                            \
+            ++failures;                                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+constexpr lzss::Level LEVELS[] = {lzss::Level::fast, lzss::Level::greedy, lzss::Level::lazy, lzss::Level::optimal};
+
+// Text-like records, repeats at every distance up to 4 KB, and runs of zeros
+// and spaces, which the two initial histories treat differently.
+static std::vector<std::uint8_t> sample(std::size_t len, std::uint32_t seed)
+{
+    static const char words[] = "the quick brown fox jumps over the lazy dog 7th guest ";
+    std::vector<std::uint8_t> buf(len);
+    for (std::size_t i = 0; i < len;)
+    {
+        seed = seed * 1103515245u + 12345u;
+        std::uint32_t kind = seed >> 28, n = 1 + (seed >> 16 & 255);
+        for (std::uint32_t k = 0; k < n && i < len; ++k, ++i)
+        {
+            if (kind < 6)
+                buf[i] = static_cast<std::uint8_t>(words[(seed + k) % (sizeof words - 1)]);
+            else if (kind < 10 && i > 0)
+                buf[i] = buf[i - 1 - (seed >> 4) % (i < 4096 ? i : 4096)];
+            else if (kind < 12)
+                buf[i] = static_cast<std::uint8_t>(seed >> (k % 24));
+            else
+                buf[i] = kind < 14 ? 0 : ' ';
+        }
+    }
+    return buf;
+}
+
+// Runs the 1989 Encode() or Decode() on bytes, through tmpfile()s as the
+// original program does its I/O.
+static std::vector<std::uint8_t> run_1989(bool encode, std::span<const std::uint8_t> bytes)
+{
+    std::FILE *in = std::tmpfile(), *out = std::tmpfile();
+    std::vector<std::uint8_t> result;
+    if (!in || !out)
+    {
+        CHECK(!"tmpfile");
+        return result;
+    }
+    std::fwrite(bytes.data(), 1, bytes.size(), in);
+    std::rewind(in);
+    if (encode)
+        lzss1989_encode(in, out);
+    else
+        lzss1989_decode(in, out);
+    result.resize(static_cast<std::size_t>(std::ftell(out)));
+    std::rewind(out);
+    CHECK(std::fread(result.data(), 1, result.size(), out) == result.size());
+    std::fclose(in);
+    std::fclose(out);
+    return result;
+}
+
+// SeventhGuest writes the library's bytes at every level, and each side
+// decodes the other's streams.
+static void test_seventh_guest(const std::vector<std::uint8_t> &src)
+{
+    std::vector<std::uint8_t> packed(lzss_bound(src.size())), back(src.size());
+    for (lzss::Level level : LEVELS)
+    {
+        std::int64_t n = lzss_compress(src.data(), src.size(), packed.data(), packed.size(), static_cast<int>(level));
+        CHECK(n >= 0);
+        if (n < 0)
+            continue;
+        std::vector<std::uint8_t> cpp = lzss::compress<lzss::SeventhGuest>(src, level);
+        CHECK(cpp.size() == static_cast<std::size_t>(n) && std::memcmp(cpp.data(), packed.data(), cpp.size()) == 0);
+        CHECK(lzss::decompress<lzss::SeventhGuest>({packed.data(), static_cast<std::size_t>(n)}) == src);
+        CHECK(lzss_decompress(cpp.data(), cpp.size(), back.data(), back.size()) ==
+                  static_cast<std::int64_t>(src.size()) &&
+              back == src);
+    }
+}
+
+// Okumura streams decode with the 1989 program and the other way round, and
+// greedy writes the 1989 program's bytes.
+static void test_okumura(const std::vector<std::uint8_t> &src)
+{
+    for (lzss::Level level : LEVELS)
+        CHECK(run_1989(false, lzss::compress<lzss::Okumura>(src, level)) == src);
+    std::vector<std::uint8_t> reference = run_1989(true, src);
+    CHECK(lzss::decompress<lzss::Okumura>(reference) == src);
+    CHECK(lzss::compress<lzss::Okumura>(src, lzss::Level::greedy) == reference);
+}
+
+// The 11/5 split has no other codec to compare with; it round-trips.
+static void test_seventh_guest_11_5(const std::vector<std::uint8_t> &src)
+{
+    for (lzss::Level level : LEVELS)
+        CHECK(lzss::decompress<lzss::SeventhGuest11_5>(lzss::compress<lzss::SeventhGuest11_5>(src, level)) == src);
+}
+
+int main()
+{
+    for (std::size_t len : {std::size_t{0}, std::size_t{1}, std::size_t{17}, std::size_t{4000}, std::size_t{70000}})
+    {
+        std::vector<std::uint8_t> src = sample(len, static_cast<std::uint32_t>(len) + 7);
+        test_seventh_guest(src);
+        test_okumura(src);
+        test_seventh_guest_11_5(src);
+    }
+    if (failures)
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+    else
+        std::printf("test_cpp: ok\n");
+    return failures ? 1 : 0;
+}
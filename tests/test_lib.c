@@ -0,0 +1,312 @@
+// test_lib.c — regression tests for the library API (lzss.h)
+// Run through tests/run.sh. Prints each failed check and exits 1 if any.
+
+#include "../lzss.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond)                                                                                                    \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(cond))                                                                                                   \
+        {                                                                                                              \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond);                                                 \
+            ++failures;                                                                                                \
+        }                                                                                                              \
+    } while (0)
+
+// A stream that ends in a flag byte with no tokens after it, or in half a
+// pair, decodes into a buffer of exactly its raw size.
+static void test_exact_cap(void)
+{
+    static const uint8_t cut_pair[] = {0x01, 'A', 0x00}; // literal, then one byte of a pair
+    static const uint8_t trailing_flag[] = {0xFF, 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 0x00};
+    uint8_t out[16];
+    CHECK(lzss_raw_size(cut_pair, sizeof cut_pair) == 1);
+    CHECK(lzss_decompress(cut_pair, sizeof cut_pair, out, 1) == 1 && out[0] == 'A');
+    CHECK(lzss_decompress(cut_pair, sizeof cut_pair, out, sizeof out) == 1);
+    CHECK(lzss_raw_size(trailing_flag, sizeof trailing_flag) == 8);
+    CHECK(lzss_decompress(trailing_flag, sizeof trailing_flag, out, 8) == 8 && memcmp(out, "ABCDEFGH", 8) == 0);
+
+    // A whole token that does not fit is still reported.
+    static const uint8_t two_literals[] = {0x03, 'A', 'B'};
+    CHECK(lzss_decompress(two_literals, sizeof two_literals, out, 1) == LZSS_E_DST_SIZE);
+}
+
+// Longest pair in a stream, found by walking its tokens.
+static int longest_pair(const uint8_t *src, size_t len)
+{
+    int longest = 0;
+    for (size_t at = 0; at < len;)
+    {
+        uint8_t flags = src[at++];
+        for (int bit = 0; bit < 8 && at < len; ++bit)
+        {
+            if (flags >> bit & 1)
+                ++at;
+            else if (at + 1 < len)
+            {
+                int n = (src[at] & 0x0F) + 3;
+                longest = n > longest ? n : longest;
+                at += 2;
+            }
+            else
+                at = len;
+        }
+    }
+    return longest;
+}
+
+// The greedy levels keep the reference encoder's 16-byte pairs; lazy and
+// optimal use all 18.
+static void test_match_caps(void)
+{
+    static uint8_t src[600], packed[700], out[600];
+    for (size_t i = 0; i < sizeof src; ++i)
+        src[i] = i < 300 ? 'a' : (uint8_t)("abcdefgh"[i % 8] + i / 97);
+    for (int level = LZSS_LEVEL_SCAN; level <= LZSS_LEVEL_OPTIMAL; ++level)
+    {
+        int64_t n = lzss_compress(src, sizeof src, packed, sizeof packed, level);
+        CHECK(n > 0);
+        if (n <= 0)
+            continue;
+        CHECK(longest_pair(packed, (size_t)n) == (level <= LZSS_LEVEL_GREEDY ? 16 : 18));
+        CHECK(lzss_decompress(packed, (size_t)n, out, sizeof out) == (int64_t)sizeof src);
+        CHECK(memcmp(out, src, sizeof src) == 0);
+    }
+}
+
+// Deterministic test data: runs of text-like records with repeats at every
+// distance, random stretches and zeros, so every token kind and distance up
+// to the full 4 KB appears, well past the first 4 KB.
+static void fill_sample(uint8_t *buf, size_t len, uint32_t seed)
+{
+    static const char words[] = "the quick brown fox jumps over the lazy dog 7th guest ";
+    for (size_t i = 0; i < len;)
+    {
+        seed = seed * 1103515245u + 12345u;
+        uint32_t kind = seed >> 28, n = 1 + (seed >> 16 & 255);
+        for (uint32_t k = 0; k < n && i < len; ++k, ++i)
+        {
+            if (kind < 6)
+                buf[i] = (uint8_t)words[(seed + k) % (sizeof words - 1)];
+            else if (kind < 10 && i > 0)
+                buf[i] = buf[i - 1 - (seed >> 4) % (i < 4096 ? i : 4096)];
+            else if (kind < 13)
+                buf[i] = (uint8_t)(seed >> (k % 24));
+            else
+                buf[i] = 0;
+        }
+    }
+}
+
+// Every level round-trips, and the streaming encoder fed a few bytes at a
+// time writes the same bytes as the one-shot call.
+static void test_levels(void)
+{
+    enum
+    {
+        LEN = 50000
+    };
+    static uint8_t src[LEN], packed[LEN + LEN / 8 + 1], streamed[LEN + LEN / 8 + 1], out[LEN];
+    fill_sample(src, LEN, 2);
+    for (int level = LZSS_LEVEL_SCAN; level <= LZSS_LEVEL_OPTIMAL; ++level)
+    {
+        int64_t n = lzss_compress(src, LEN, packed, sizeof packed, level);
+        CHECK(n > 0 && n < LEN);
+        CHECK(lzss_decompress(packed, (size_t)n, out, LEN) == LEN && memcmp(out, src, LEN) == 0);
+
+        lzss_encoder *e = lzss_encoder_create(level);
+        size_t at = 0, produced = 0;
+        lzss_status st = LZSS_OK;
+        while (st == LZSS_OK)
+        {
+            size_t in_len = LEN - at < 7 ? LEN - at : 7, out_len = 5;
+            st = lzss_encoder_run(e, src + at, &in_len, streamed + produced, &out_len, at + in_len == LEN);
+            at += in_len;
+            produced += out_len;
+        }
+        lzss_encoder_destroy(e);
+        CHECK(st == LZSS_END && (int64_t)produced == n && memcmp(streamed, packed, produced) == 0);
+    }
+    CHECK(lzss_compress(src, LEN, packed, sizeof packed, LZSS_LEVEL_OPTIMAL + 1) == LZSS_E_PARAM);
+}
+
+// The format decoded a byte at a time, history zeroed, as the original
+// decoder does. dst has N bytes in front of it for the history.
+static size_t reference_decode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+    memset(dst - LZSS_HISTORY, 0, LZSS_HISTORY);
+    size_t o = 0;
+    for (size_t i = 0; i < len;)
+    {
+        uint8_t flags = src[i++];
+        for (int bit = 0; bit < 8 && i < len; ++bit)
+        {
+            if (flags >> bit & 1)
+                dst[o++] = src[i++];
+            else if (i + 1 < len)
+            {
+                unsigned v = src[i] | (unsigned)src[i + 1] << 8;
+                size_t dist = (v >> 4) + 1, n = (v & 0x0F) + 3;
+                for (size_t k = 0; k < n; ++k, ++o)
+                    dst[o] = dst[o - dist];
+                i += 2;
+            }
+            else
+                return o; // half a pair ends the stream
+        }
+    }
+    return o;
+}
+
+// The buffer-to-buffer decoder, with its wide overlapping match copies, agrees
+// with the reference on arbitrary streams, at short distances especially; so
+// does the incremental decoder fed 3 bytes in and 5 bytes out at a time.
+static void test_decoder(void)
+{
+    enum
+    {
+        LEN = 3000,
+        CAP = LEN * 9
+    };
+    static uint8_t src[LEN], want[LZSS_HISTORY + CAP], got[CAP];
+    uint32_t seed = 1;
+    for (int round = 0; round < 200; ++round)
+    {
+        size_t len = 1 + (size_t)round * 13 % LEN;
+        for (size_t i = 0; i < len; ++i)
+        {
+            seed = seed * 1103515245u + 12345u;
+            src[i] = (uint8_t)(seed >> 16);
+            // Every other round a third of the bytes are 0 or 1, so many
+            // pairs reach back only 1 to 32 bytes and overlap their output.
+            if (round & 1 && i % 3 == 2)
+                src[i] &= 0x01;
+        }
+        size_t n = reference_decode(src, len, want + LZSS_HISTORY);
+        CHECK(lzss_raw_size(src, len) == n);
+        CHECK(lzss_decompress(src, len, got, CAP) == (int64_t)n && memcmp(got, want + LZSS_HISTORY, n) == 0);
+
+        lzss_decoder *d = lzss_decoder_create();
+        size_t at = 0, produced = 0;
+        lzss_status st = LZSS_OK;
+        while (st == LZSS_OK)
+        {
+            size_t in_len = len - at < 3 ? len - at : 3, out_len = 5;
+            st = lzss_decoder_run(d, src + at, &in_len, got + produced, &out_len, at + in_len == len);
+            at += in_len;
+            produced += out_len;
+        }
+        lzss_decoder_destroy(d);
+        CHECK(st == LZSS_END && produced == n && memcmp(got, want + LZSS_HISTORY, n) == 0);
+    }
+}
+
+// Every kernel set the CPU has writes the same stream as the scalar kernels
+// at every level and decodes it, and short overlapping copies, the same way.
+// Only the ASM build on x86-64 has more than scalar; run.sh builds both.
+static void test_kernels(void)
+{
+    enum
+    {
+        LEN = 50000,
+        BOUND = LEN + LEN / 8 + 1
+    };
+    static uint8_t src[LEN], scalar[LZSS_LEVEL_OPTIMAL + 1][BOUND], packed[BOUND], out[LEN];
+    static int64_t scalar_len[LZSS_LEVEL_OPTIMAL + 1];
+    fill_sample(src, LEN, 3);
+    int best = lzss_simd_limit(LZSS_SIMD_AVX2);
+    for (int simd = LZSS_SIMD_SCALAR; simd <= best; ++simd)
+    {
+        CHECK(lzss_simd_limit(simd) == simd);
+        for (int level = LZSS_LEVEL_SCAN; level <= LZSS_LEVEL_OPTIMAL; ++level)
+        {
+            int64_t n = lzss_compress(src, LEN, simd ? packed : scalar[level], BOUND, level);
+            if (simd == LZSS_SIMD_SCALAR)
+                scalar_len[level] = n;
+            else
+                CHECK(n == scalar_len[level] && memcmp(packed, scalar[level], (size_t)n) == 0);
+            CHECK(lzss_decompress(scalar[level], (size_t)scalar_len[level], out, LEN) == LEN &&
+                  memcmp(out, src, LEN) == 0);
+        }
+        // Literal 'a', then pairs at distance 1 to 16 of every length.
+        static uint8_t runs[32 * (1 + 2 * 8)], want[LZSS_HISTORY + 32 * 18 * 8 + 1];
+        size_t len = 0;
+        for (int g = 0; g < 32; ++g)
+        {
+            runs[len++] = g == 0 ? 0x01 : 0x00;
+            for (int t = 0; t < 8; ++t)
+            {
+                if (g == 0 && t == 0)
+                {
+                    runs[len++] = 'a' + (uint8_t)simd;
+                    continue;
+                }
+                unsigned v = (unsigned)((g + t) % 16) << 4 | (unsigned)(g * 8 + t) % 16;
+                runs[len++] = (uint8_t)v;
+                runs[len++] = (uint8_t)(v >> 8);
+            }
+        }
+        size_t n = reference_decode(runs, len, want + LZSS_HISTORY);
+        CHECK(lzss_decompress(runs, len, out, LEN) == (int64_t)n && memcmp(out, want + LZSS_HISTORY, n) == 0);
+    }
+    lzss_simd_limit(LZSS_SIMD_AVX2);
+}
+
+// Any range extracted through a checkpoint index equals the same range of a
+// full decode, across checkpoints and at the end of the stream; an index for
+// another stream is refused.
+static void test_extract(void)
+{
+    enum
+    {
+        LEN = 50000,
+        BOUND = LEN + LEN / 8 + 1
+    };
+    static uint8_t src[LEN], packed[BOUND], other[BOUND], out[LEN];
+    fill_sample(src, LEN, 4);
+    int64_t n = lzss_compress(src, LEN, packed, BOUND, LZSS_LEVEL_LAZY);
+    size_t cap = lzss_index_bound(LEN, LZSS_INDEX_INTERVAL_MIN);
+    uint8_t *index = (uint8_t *)malloc(cap);
+    int64_t ilen = lzss_index_build(packed, (size_t)n, LZSS_INDEX_INTERVAL_MIN, index, cap);
+    CHECK(n > 0 && ilen > 0);
+    if (n <= 0 || ilen <= 0)
+    {
+        free(index);
+        return;
+    }
+    uint32_t seed = 5;
+    for (int round = 0; round < 100; ++round)
+    {
+        seed = seed * 1103515245u + 12345u;
+        size_t offset = seed % LEN, want = round < 90 ? (seed >> 8) % 9000 : LEN;
+        size_t expect = LEN - offset < want ? LEN - offset : want;
+        CHECK(lzss_extract(packed, (size_t)n, index, (size_t)ilen, offset, out, want) == (int64_t)expect &&
+              memcmp(out, src + offset, expect) == 0);
+    }
+    CHECK(lzss_extract(packed, (size_t)n, index, (size_t)ilen, LEN, out, 10) == 0);
+
+    fill_sample(src, LEN, 6);
+    int64_t m = lzss_compress(src, LEN, other, BOUND, LZSS_LEVEL_LAZY);
+    CHECK(m > 0 && m != n && lzss_extract(other, (size_t)m, index, (size_t)ilen, 0, out, 100) == LZSS_E_INDEX);
+    free(index);
+}
+
+int main(void)
+{
+    test_exact_cap();
+    test_match_caps();
+    test_levels();
+    test_decoder();
+    test_kernels();
+    test_extract();
+    if (failures)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    else
+        printf("test_lib: ok (kernels up to %s)\n", lzss_simd_name(lzss_simd()));
+    return failures ? 1 : 0;
+}